@@ -0,0 +1,504 @@
+/*
+Copyright (c) 2006, Scott E. Dillard
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+/*
+ * End to end benchmarks. For each synthetic field and size this times the
+ * phases of the pipeline, run serially, and with ct_sweepAndMergeParallel
+ * and as slices through ct_batch at 1 to N threads. The results are written
+ * as JSON, one result per line, and compared with a baseline in the same
+ * format from the same machine. See bench/README.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "tourtre.h"
+#include "benchField.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+
+
+/* sizes run by default, and with --full */
+static const char *bench_quickSizes = "64x64,256x256,1024x1024,64x64x64,128x128x128";
+static const char *bench_fullSizes = 
+    "64x64,256x256,1024x1024,4096x4096,64x64x64,128x128x128,256x256x256,512x512x512,1024x1024x1024";
+
+enum { BENCH_SORT, BENCH_JOIN, BENCH_SPLIT, BENCH_MERGE, BENCH_SWEEP_AND_MERGE, 
+       BENCH_DECOMPOSE, BENCH_TOTAL, BENCH_NUM_PHASES };
+static const char *bench_phaseNames[BENCH_NUM_PHASES] = 
+    { "sort", "join_sweep", "split_sweep", "merge", "sweep_and_merge", "decompose", "total" };
+
+typedef struct benchResult
+{
+    char key[128];
+    const char *field;
+    size_t dims[3], numVerts;
+    const char *mode;
+    size_t threads;
+    double seconds[BENCH_NUM_PHASES];  /* < 0 if the mode doesn't time it */
+    size_t libraryPeak;
+    int hasEvents;  /* from ct_hardwareCounters, in a CT_STATS build */
+    double events[CT_NUM_PHASES][CT_NUM_EVENTS];
+    int eventCounted[CT_NUM_EVENTS];
+} benchResult;
+
+/* names in the JSON for ctPhase and ctEvent */
+static const char *bench_ctPhaseNames[CT_NUM_PHASES] = 
+    { "sort", "join_sweep", "split_sweep", "augment", "merge", "decompose", "branch_map" };
+static const char *bench_eventNames[CT_NUM_EVENTS] = 
+    { "cycles", "instructions", "llc_misses", "dtlb_misses", "branch_misses" };
+
+
+static
+double
+bench_now( void )
+{
+    struct timespec t;
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+
+/* What the results are only comparable on: the processor, as Linux names
+ * it, or else the architecture, and the number of cores. */
+static
+void
+bench_machine( char m[128], size_t cores )
+{
+    char line[256], name[128] = "";
+    FILE *in = fopen( "/proc/cpuinfo", "r" );
+    size_t i, j;
+
+    if ( in ) {
+        while ( fgets( line, sizeof(line), in ) ) {
+            char *c = strchr( line, ':' );
+            if ( strncmp( line, "model name", 10 ) != 0 || !c ) continue;
+            for ( c++; *c == ' '; c++ ) ;
+            /* no quotes or control characters in the JSON string */
+            for ( i = j = 0; c[i] && j + 1 < sizeof(name); i++ ) 
+                if ( c[i] >= ' ' && c[i] != '"' && c[i] != '\\' ) name[j++] = c[i];
+            name[j] = 0;
+            break;
+        }
+        fclose( in );
+    }
+    if ( !name[0] ) {
+        struct utsname u;
+        strcpy( name, uname( &u ) == 0 ? u.machine : "unknown" );
+    }
+    sprintf( m, "%.100s, %lu cores", name, (unsigned long) cores );
+}
+
+
+static
+void
+bench_start( benchResult * r, const benchField * f, const char * mode, size_t threads )
+{
+    int p;
+    memset( r, 0, sizeof(benchResult) );
+    sprintf( r->key, "%s/%lux%lux%lu/%s/%lu", f->name, (unsigned long) f->dims[0], 
+        (unsigned long) f->dims[1], (unsigned long) f->dims[2], mode, (unsigned long) threads );
+    r->field = f->name;
+    memcpy( r->dims, f->dims, sizeof(r->dims) );
+    r->numVerts = f->numVerts;
+    r->mode = mode;
+    r->threads = threads;
+    for ( p = 0; p < BENCH_NUM_PHASES; p++ ) r->seconds[p] = -1;
+}
+
+
+/* The hardware events of each phase that ran, leaving out the ones that
+ * weren't counted. */
+static
+void
+bench_writeEvents( FILE * out, const benchResult * r )
+{
+    int p, e, first = 1;
+
+    fprintf( out, ", \"events\": {" );
+    for ( p = 0; p < CT_NUM_PHASES; p++ ) {
+        int any = 0, firstEvent = 1;
+        for ( e = 0; e < CT_NUM_EVENTS; e++ ) if ( r->events[p][e] > 0 ) any = 1;
+        if ( !any ) continue;
+        fprintf( out, "%s\"%s\": {", first ? "" : ", ", bench_ctPhaseNames[p] );
+        for ( e = 0; e < CT_NUM_EVENTS; e++ ) {
+            if ( !r->eventCounted[e] ) continue;
+            fprintf( out, "%s\"%s\": %.0f", firstEvent ? "" : ", ", 
+                bench_eventNames[e], r->events[p][e] );
+            firstEvent = 0;
+        }
+        fprintf( out, "}" );
+        first = 0;
+    }
+    fprintf( out, "}" );
+}
+
+
+static
+void
+bench_write( FILE * out, const benchResult * r )
+{
+    int p, first;
+
+    fprintf( out, "{\"key\": \"%s\", \"field\": \"%s\", \"dims\": [%lu, %lu, %lu], "
+        "\"vertices\": %lu, \"mode\": \"%s\", \"threads\": %lu, \"seconds\": {", 
+        r->key, r->field, (unsigned long) r->dims[0], (unsigned long) r->dims[1], 
+        (unsigned long) r->dims[2], (unsigned long) r->numVerts, r->mode, 
+        (unsigned long) r->threads );
+    for ( p = 0, first = 1; p < BENCH_NUM_PHASES; p++ ) {
+        if ( r->seconds[p] < 0 ) continue;
+        fprintf( out, "%s\"%s\": %.6f", first ? "" : ", ", bench_phaseNames[p], r->seconds[p] );
+        first = 0;
+    }
+    fprintf( out, "}, \"vertices_per_second\": {" );
+    for ( p = 0, first = 1; p < BENCH_NUM_PHASES; p++ ) {
+        if ( r->seconds[p] < 0 ) continue;
+        fprintf( out, "%s\"%s\": %.0f", first ? "" : ", ", bench_phaseNames[p], 
+            r->numVerts / ( r->seconds[p] > 0 ? r->seconds[p] : 1e-9 ) );
+        first = 0;
+    }
+    fprintf( out, "}" );
+    if ( r->libraryPeak ) 
+        fprintf( out, ", \"library_peak_bytes\": %lu", (unsigned long) r->libraryPeak );
+    if ( r->hasEvents ) bench_writeEvents( out, r );
+    fprintf( out, "}" );
+}
+
+
+/* Keep the hardware events of this run, if any were counted. */
+static
+void
+bench_events( benchResult * r, ctContext * ctx )
+{
+    ctStats s = ct_stats( ctx );
+    int e;
+
+    for ( e = 0; e < CT_NUM_EVENTS; e++ ) if ( s.eventCounted[e] ) r->hasEvents = 1;
+    if ( !r->hasEvents ) return;
+    memcpy( r->events, s.events, sizeof(r->events) );
+    memcpy( r->eventCounted, s.eventCounted, sizeof(r->eventCounted) );
+}
+
+
+/* The serial or parallel pipeline on one field, the parallel one on up to
+ * threads threads. order has room for the total order. */
+static
+void
+bench_pipeline( benchResult * r, benchField * f, ctIndex * order, int parallel, size_t threads )
+{
+    ctContext *ctx;
+    ctBranch *root;
+    double t0, t1;
+
+    ct_numThreads( parallel ? threads : 1 );
+    t0 = bench_now();
+    ct_sortVertices( f->values, f->type, f->numVerts, order );
+    r->seconds[BENCH_SORT] = bench_now() - t0;
+    ctx = ct_initGrid( f->dims, CT_GRID_FREUDENTHAL, order, benchField_value, f );
+    ct_hardwareCounters( ctx, 1 );
+
+    t0 = bench_now();
+    if ( parallel ) {
+        ct_sweepAndMergeParallel( ctx );
+        r->seconds[BENCH_SWEEP_AND_MERGE] = bench_now() - t0;
+    } else {
+        ct_joinSweep( ctx );
+        t1 = bench_now();
+        r->seconds[BENCH_JOIN] = t1 - t0;
+        ct_splitSweep( ctx );
+        r->seconds[BENCH_SPLIT] = bench_now() - t1;
+        t1 = bench_now();
+        ct_mergeTrees( ctx );
+        r->seconds[BENCH_MERGE] = bench_now() - t1;
+    }
+    t1 = bench_now();
+    root = ct_decompose( ctx );
+    r->seconds[BENCH_DECOMPOSE] = bench_now() - t1;
+    r->seconds[BENCH_TOTAL] = bench_now() - t0 + r->seconds[BENCH_SORT];
+    r->libraryPeak = ct_memoryStats( ctx ).totalPeak;
+    bench_events( r, ctx );
+
+    ct_cleanup( ctx );
+    ct_deleteBranchTree( root, ctx );
+    ct_numThreads( 0 );
+}
+
+
+/* The field cut into slices, 2D along z or strips of rows, run through
+ * ct_batch. */
+static
+void
+bench_batch( benchResult * r, benchField * f, size_t threads )
+{
+    size_t rows = f->dims[2] > 1 ? f->dims[1] : 64;
+    size_t per = f->dims[0] * rows;
+    size_t numJobs = (f->numVerts + per - 1) / per, j;
+    size_t elem = f->type == CT_VALUE_UINT8 ? 1 : sizeof(double);
+    ctJob *jobs = (ctJob*) calloc( numJobs, sizeof(ctJob) );
+    double t0;
+
+    if ( rows > f->dims[1] ) rows = f->dims[1];
+    for ( j = 0; j < numJobs; j++ ) {
+        size_t first = j * per;
+        size_t n = first + per < f->numVerts ? per : f->numVerts - first;
+        jobs[j].numVertices = n;
+        jobs[j].values = (char*) f->values + first * elem;
+        jobs[j].valueType = f->type;
+        jobs[j].dims[0] = f->dims[0];
+        jobs[j].dims[1] = n / f->dims[0];
+        jobs[j].dims[2] = 1;
+        jobs[j].connectivity = CT_GRID_FREUDENTHAL;
+    }
+
+    t0 = bench_now();
+    ct_batch( jobs, numJobs, threads );
+    r->seconds[BENCH_TOTAL] = bench_now() - t0;
+
+    for ( j = 0; j < numJobs; j++ ) ct_deleteBranchTree( jobs[j].root, NULL );
+    free( jobs );
+}
+
+
+/* Run one benchmark at least repeat times, and until it has taken a while,
+ * keeping the best time of each phase in r. */
+static
+void
+bench_repeat( benchResult * r, benchField * f, ctIndex * order, int mode, size_t threads, int repeat )
+{
+    double start = bench_now();
+    int i, p;
+
+    for ( i = 0; i < repeat || ( bench_now() - start < 0.25 && i < 1000 ); i++ ) {
+        benchResult once = *r;
+        if ( mode < 2 ) bench_pipeline( &once, f, order, mode, threads );
+        else bench_batch( &once, f, threads );
+
+        for ( p = 0; p < BENCH_NUM_PHASES; p++ ) 
+            if ( i == 0 || once.seconds[p] < r->seconds[p] ) r->seconds[p] = once.seconds[p];
+        r->libraryPeak = once.libraryPeak;
+        if ( once.hasEvents ) {
+            r->hasEvents = 1;
+            memcpy( r->events, once.events, sizeof(r->events) );
+            memcpy( r->eventCounted, once.eventCounted, sizeof(r->eventCounted) );
+        }
+    }
+}
+
+
+/* Compare with the baseline: every key in both must be at least
+ * (1-tolerance) times as fast in total. A baseline from another machine
+ * says nothing about this one, so it is only reported. Returns the number
+ * of regressions. */
+static
+int
+bench_compare( const char * path, const char * machine, 
+               benchResult * results, size_t numResults, double tolerance )
+{
+    FILE *in = fopen( path, "r" );
+    char line[4096];
+    const char *m;
+    int regressions = 0, matched = 0;
+
+    if ( !in ) {
+        fprintf( stderr, "bench : can't read baseline %s\n", path );
+        return 0;
+    }
+    /* the first line has the machine */
+    if ( !fgets( line, sizeof(line), in ) || !(m = strstr( line, "\"machine\": \"" )) ||
+         strncmp( m + 12, machine, strlen(machine) ) != 0 || m[12 + strlen(machine)] != '"' ) 
+    {
+        fprintf( stderr, "bench : %s is from another machine than %s, not compared\n", 
+            path, machine );
+        fclose( in );
+        return 0;
+    }
+    while ( fgets( line, sizeof(line), in ) ) {
+        char key[128];
+        const char *k = strstr( line, "\"key\": \"" ), *v;
+        double base, now;
+        size_t i, len;
+        if ( !k ) continue;
+        k += 8;
+        len = strcspn( k, "\"" );
+        if ( len >= sizeof(key) ) continue;
+        memcpy( key, k, len );
+        key[len] = 0;
+
+        v = strstr( line, "\"vertices_per_second\"" );
+        v = v ? strstr( v, "\"total\": " ) : NULL;
+        if ( !v || sscanf( v + 9, "%lf", &base ) != 1 ) continue;
+
+        for ( i = 0; i < numResults; i++ ) 
+            if ( strcmp( results[i].key, key ) == 0 ) break;
+        if ( i == numResults ) continue;
+
+        matched++;
+        now = results[i].numVerts / results[i].seconds[BENCH_TOTAL];
+        if ( now < (1 - tolerance) * base ) {
+            fprintf( stderr, "REGRESSION %s: %.0f vertices/s, baseline %.0f (%+.0f%%)\n", 
+                key, now, base, 100 * (now / base - 1) );
+            regressions++;
+        }
+    }
+    fclose( in );
+    fprintf( stderr, "bench : %d results compared with %s, %d regressions\n", 
+        matched, path, regressions );
+    return regressions;
+}
+
+
+static
+void
+bench_usage( void )
+{
+    fprintf( stderr, 
+        "usage: bench [options]\n"
+        "  --sizes WxH[xD],...  grid sizes (default %s)\n"
+        "  --full               all sizes, 64x64 up to 1024x1024x1024\n"
+        "  --fields a,b,...     fields to run (default all)\n"
+        "  --threads N          most threads for parallel and batch (default: cores)\n"
+        "  --seed S             seed for the fields (default 1)\n"
+        "  --repeat R           runs of each, at least, keeping the best (default 3)\n", 
+        bench_quickSizes );
+    fprintf( stderr, 
+        "  --out FILE           write results there instead of stdout\n"
+        "  --baseline FILE      compare with an earlier --out\n"
+        "  --tolerance T        allowed slowdown against the baseline (default 0.25)\n" );
+}
+
+
+int
+main( int argc, char ** argv )
+{
+    const char *sizes = bench_quickSizes, *fields = NULL, *outPath = NULL, *basePath = NULL;
+    size_t cores, maxThreads = 0, numResults = 0, capResults = 64;
+    char machine[128];
+    unsigned long seed = 1;
+    double tolerance = 0.25;
+    benchResult *results;
+    FILE *out = stdout;
+    const char *s;
+    int a, repeat = 3, regressions = 0;
+
+    for ( a = 1; a < argc; a++ ) {
+        if ( strcmp( argv[a], "--full" ) == 0 ) sizes = bench_fullSizes;
+        else if ( a+1 < argc && strcmp( argv[a], "--sizes" ) == 0 ) sizes = argv[++a];
+        else if ( a+1 < argc && strcmp( argv[a], "--fields" ) == 0 ) fields = argv[++a];
+        else if ( a+1 < argc && strcmp( argv[a], "--threads" ) == 0 ) maxThreads = atoi( argv[++a] );
+        else if ( a+1 < argc && strcmp( argv[a], "--seed" ) == 0 ) seed = atol( argv[++a] );
+        else if ( a+1 < argc && strcmp( argv[a], "--repeat" ) == 0 ) repeat = atoi( argv[++a] );
+        else if ( a+1 < argc && strcmp( argv[a], "--out" ) == 0 ) outPath = argv[++a];
+        else if ( a+1 < argc && strcmp( argv[a], "--baseline" ) == 0 ) basePath = argv[++a];
+        else if ( a+1 < argc && strcmp( argv[a], "--tolerance" ) == 0 ) tolerance = atof( argv[++a] );
+        else { bench_usage(); return 2; }
+    }
+    {   long n = sysconf( _SC_NPROCESSORS_ONLN );
+        cores = n > 0 ? (size_t) n : 1;
+    }
+    if ( maxThreads == 0 ) maxThreads = cores;
+    bench_machine( machine, cores );
+    if ( outPath && !(out = fopen( outPath, "w" )) ) {
+        fprintf( stderr, "bench : can't write %s\n", outPath );
+        return 2;
+    }
+    results = (benchResult*) malloc( capResults * sizeof(benchResult) );
+
+    fprintf( out, "{\"version\": 2, \"machine\": \"%s\", \"cores\": %lu, \"seed\": %lu, "
+        "\"results\": [\n", machine, (unsigned long) cores, seed );
+
+    for ( s = sizes; *s; ) {
+        size_t dims[3] = { 1, 1, 1 };
+        int f, d = 0;
+        char *end;
+
+        /* next size, WxH or WxHxD */
+        while ( d < 3 ) {
+            dims[d++] = strtoul( s, &end, 10 );
+            s = end;
+            if ( *s != 'x' ) break;
+            s++;
+        }
+        if ( *s == ',' ) s++;
+        if ( dims[0] < 2 || dims[1] < 2 ) continue;
+
+        for ( f = 0; benchField_names[f]; f++ ) {
+            benchField field;
+            ctIndex *order;
+            size_t t;
+            int mode;
+
+            if ( fields && !strstr( fields, benchField_names[f] ) ) continue;
+            if ( !benchField_make( &field, benchField_names[f], dims, seed ) ) {
+                fprintf( stderr, "bench : no memory for %s at %lux%lux%lu\n", benchField_names[f], 
+                    (unsigned long) dims[0], (unsigned long) dims[1], (unsigned long) dims[2] );
+                continue;
+            }
+
+            order = (ctIndex*) malloc( field.numVerts * sizeof(ctIndex) );
+
+            /* serial, then parallel and batches at 1, 2, 4... threads and
+             * the most */
+            for ( mode = 0, t = 1; mode < 3; ) {
+                static const char *names[3] = { "serial", "parallel", "batch" };
+                benchResult *r;
+
+                if ( numResults == capResults ) 
+                    results = (benchResult*) realloc( results, (capResults *= 2) * sizeof(benchResult) );
+                r = &results[numResults++];
+
+                bench_start( r, &field, names[mode], t );
+                bench_repeat( r, &field, order, mode, t, repeat );
+                if ( mode == 0 || t == maxThreads ) {
+                    mode++;
+                    t = 1;
+                } else {
+                    t = 2*t > maxThreads ? maxThreads : 2*t;
+                }
+
+                fprintf( stderr, "%-44s %12.0f vertices/s\n", r->key, 
+                    r->numVerts / r->seconds[BENCH_TOTAL] );
+                fprintf( out, "%s", numResults > 1 ? ",\n" : "" );
+                bench_write( out, r );
+                fflush( out );
+            }
+
+            free( order );
+            benchField_free( &field );
+        }
+    }
+    fprintf( out, "\n]}\n" );
+    if ( out != stdout ) fclose( out );
+
+    if ( basePath ) 
+        regressions = bench_compare( basePath, machine, results, numResults, tolerance );
+    free( results );
+    return regressions ? 1 : 0;
+}
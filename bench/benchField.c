@@ -0,0 +1,225 @@
+/*
+Copyright (c) 2006, Scott E. Dillard
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+#include "benchField.h"
+
+#include <math.h>
+#include <string.h>
+
+
+const char *benchField_names[] = 
+    { "noise", "smooth", "gaussians", "sines", "plateaus", NULL };
+
+
+/* xorshift32, so the fields don't depend on the C library's rand */
+static
+double
+benchField_random( unsigned long * state )
+{
+    unsigned long x = *state;
+    x ^= (x << 13) & 0xffffffffUL;
+    x ^= x >> 17;
+    x ^= (x << 5) & 0xffffffffUL;
+    *state = x;
+    return (double) x / 4294967296.0;
+}
+
+
+static
+void
+benchField_noise( double * v, size_t n, unsigned long * state )
+{
+    size_t i;
+    for ( i = 0; i < n; i++ ) v[i] = benchField_random( state );
+}
+
+
+/* Box blur of radius r along one axis, clamped at the ends. */
+static
+void
+benchField_blurAxis( double * v, const size_t dims[3], int axis, size_t r )
+{
+    size_t len = dims[axis];
+    size_t stride = axis == 0 ? 1 : axis == 1 ? dims[0] : dims[0]*dims[1];
+    size_t numLines = dims[0]*dims[1]*dims[2] / len;
+    double *line = (double*) malloc( len * sizeof(double) );
+    size_t l, i;
+
+    for ( l = 0; l < numLines; l++ ) {
+        /* the first vertex of line l */
+        size_t start = axis == 0 ? l * len 
+                     : axis == 1 ? (l / dims[0]) * dims[0]*dims[1] + l % dims[0]
+                     : l;
+        double sum = 0;
+        for ( i = 0; i < len; i++ ) line[i] = v[start + i*stride];
+        for ( i = 0; i <= r && i < len; i++ ) sum += line[i];
+        for ( i = 0; i < len; i++ ) {
+            size_t lo = i > r ? i - r : 0;
+            size_t hi = i + r < len ? i + r : len - 1;
+            v[start + i*stride] = sum / (hi - lo + 1);
+            if ( i + r + 1 < len ) sum += line[i + r + 1];
+            if ( i >= r ) sum -= line[i - r];
+        }
+    }
+    free( line );
+}
+
+
+static
+void
+benchField_smooth( double * v, const size_t dims[3], unsigned long * state )
+{
+    int pass, axis;
+    benchField_noise( v, dims[0]*dims[1]*dims[2], state );
+    for ( pass = 0; pass < 3; pass++ ) 
+        for ( axis = 0; axis < 3; axis++ ) 
+            if ( dims[axis] > 1 ) benchField_blurAxis( v, dims, axis, 2 );
+}
+
+
+/* A sum of Gaussian bumps, positive and negative. Each is only evaluated
+ * out to three sigma, so the cost stays linear in the size. */
+static
+void
+benchField_gaussians( double * v, const size_t dims[3], unsigned long * state )
+{
+    size_t n = dims[0]*dims[1]*dims[2];
+    size_t side = dims[0], x, y, z;
+    int k, d;
+
+    memset( v, 0, n * sizeof(double) );
+    for ( d = 1; d < 3; d++ ) if ( dims[d] > side ) side = dims[d];
+
+    for ( k = 0; k < 32; k++ ) {
+        double c[3], sigma, height;
+        size_t lo[3], hi[3];
+        sigma = side * ( 0.02 + 0.04 * benchField_random(state) );
+        height = 2 * benchField_random(state) - 0.5;
+        for ( d = 0; d < 3; d++ ) {
+            double a, b;
+            c[d] = dims[d] > 1 ? dims[d] * benchField_random(state) : 0;
+            a = c[d] - 3*sigma;
+            b = c[d] + 3*sigma;
+            lo[d] = a > 0 ? (size_t) a : 0;
+            hi[d] = b < dims[d] - 1 ? (size_t) b : dims[d] - 1;
+        }
+        for ( z = lo[2]; z <= hi[2]; z++ ) 
+        for ( y = lo[1]; y <= hi[1]; y++ ) 
+        for ( x = lo[0]; x <= hi[0]; x++ ) {
+            double dx = x - c[0], dy = y - c[1], dz = z - c[2];
+            v[x + dims[0]*(y + dims[1]*z)] += 
+                height * exp( -(dx*dx + dy*dy + dz*dz) / (2*sigma*sigma) );
+        }
+    }
+}
+
+
+static
+void
+benchField_sines( double * v, const size_t dims[3], unsigned long * state )
+{
+    double f[3], p[3];
+    size_t x, y, z;
+    int d;
+    for ( d = 0; d < 3; d++ ) {
+        f[d] = 2 * 3.14159265358979 * ( 3 + 5 * benchField_random(state) ) / dims[d];
+        p[d] = dims[d] > 1 ? 6.2831853 * benchField_random(state) : 1.5707963;
+    }
+    for ( z = 0; z < dims[2]; z++ ) 
+    for ( y = 0; y < dims[1]; y++ ) 
+    for ( x = 0; x < dims[0]; x++ ) 
+        v[x + dims[0]*(y + dims[1]*z)] = 
+            sin( f[0]*x + p[0] ) * sin( f[1]*y + p[1] ) * sin( f[2]*z + p[2] );
+}
+
+
+int
+benchField_make( benchField * f, const char * name, const size_t dims[3], unsigned long seed )
+{
+    unsigned long state = ( seed * 2654435761UL + 1 ) & 0xffffffffUL;
+    double *v;
+    size_t i;
+
+    if ( !state ) state = 1;
+    memset( f, 0, sizeof(benchField) );
+    for ( i = 0; benchField_names[i]; i++ ) 
+        if ( strcmp( name, benchField_names[i] ) == 0 ) break;
+    if ( !benchField_names[i] ) return 0;
+
+    f->name = benchField_names[i];
+    f->dims[0] = dims[0];
+    f->dims[1] = dims[1];
+    f->dims[2] = dims[2];
+    f->numVerts = dims[0]*dims[1]*dims[2];
+    f->type = CT_VALUE_DOUBLE;
+
+    v = (double*) malloc( f->numVerts * sizeof(double) );
+    if ( !v ) return 0;
+
+    if ( strcmp( name, "noise" ) == 0 ) benchField_noise( v, f->numVerts, &state );
+    else if ( strcmp( name, "smooth" ) == 0 ) benchField_smooth( v, dims, &state );
+    else if ( strcmp( name, "gaussians" ) == 0 ) benchField_gaussians( v, dims, &state );
+    else if ( strcmp( name, "sines" ) == 0 ) benchField_sines( v, dims, &state );
+    else {
+        /* smooth noise in 16 levels, so most vertices tie with a neighbor */
+        unsigned char *q = (unsigned char*) malloc( f->numVerts );
+        double lo, hi;
+        if ( !q ) { free( v ); return 0; }
+        benchField_smooth( v, dims, &state );
+        lo = hi = v[0];
+        for ( i = 1; i < f->numVerts; i++ ) {
+            if ( v[i] < lo ) lo = v[i];
+            if ( v[i] > hi ) hi = v[i];
+        }
+        for ( i = 0; i < f->numVerts; i++ ) 
+            q[i] = (unsigned char) ( 15.999 * (v[i] - lo) / (hi - lo + 1e-300) );
+        free( v );
+        f->type = CT_VALUE_UINT8;
+        f->values = q;
+        return 1;
+    }
+    f->values = v;
+    return 1;
+}
+
+
+void
+benchField_free( benchField * f )
+{
+    free( f->values );
+    f->values = NULL;
+}
+
+
+double
+benchField_value( ctIndex v, void * data )
+{
+    benchField *f = (benchField*) data;
+    if ( f->type == CT_VALUE_UINT8 ) return ((unsigned char*) f->values)[v];
+    return ((double*) f->values)[v];
+}
@@ -0,0 +1,30 @@
+#ifndef BENCH_FIELD_H
+#define BENCH_FIELD_H
+
+#include "tourtre.h"
+
+/*
+ * Synthetic scalar fields on 2D and 3D grids for the benchmarks. Each one is
+ * made from a seed with its own random number generator, so a field of a
+ * given name, size and seed is the same on every machine.
+ */
+typedef struct benchField
+{
+    const char *name;
+    size_t dims[3];     /* dims[2] is 1 in 2D */
+    size_t numVerts;
+    ctValueType type;   /* CT_VALUE_DOUBLE, or CT_VALUE_UINT8 for plateaus */
+    void *values;
+} benchField;
+
+/* the names benchField_make knows, NULL terminated */
+extern const char *benchField_names[];
+
+/* Make the named field. Returns 0 if there is no such field, or no memory. */
+int   benchField_make  ( benchField * f, const char * name, const size_t dims[3], unsigned long seed );
+void  benchField_free  ( benchField * f );
+
+/* value callback for ct_initGrid; data is the field */
+double benchField_value ( ctIndex v, void * data );
+
+#endif
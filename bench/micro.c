@@ -0,0 +1,406 @@
+/*
+Copyright (c) 2006, Scott E. Dillard
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+/*
+ * Microbenchmarks of the data structures inside the library, each on its
+ * own, with inputs chosen to be hard for it: long chains, high fanout, and
+ * random merges. Costs are given per operation, in core cycles from
+ * perf_event_open, or time stamp counter cycles where that can't be had
+ * (x86 only), and in nanoseconds. See bench/README.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "tourtre.h"
+#include "ctComponent.h"
+#include "ctQueue.h"
+#include "ctNodeMap.h"
+#include "ctBranch.h"
+#include "ctPerf.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+
+typedef struct microClock
+{
+    double cycles;
+    double seconds;
+    ctPerf perf;
+} microClock;
+
+/* whether the core's cycle counter can be read, through ctPerf */
+static int micro_perf;
+
+
+static
+double
+micro_tsc( void )
+{
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) )
+    unsigned int lo, hi;
+    __asm__ __volatile__ ( "lfence\n\trdtsc" : "=a" (lo), "=d" (hi) : : "memory" );
+    return hi * 4294967296.0 + lo;
+#else
+    return -1;
+#endif
+}
+
+
+static
+void
+micro_start( microClock * c )
+{
+    struct timespec t;
+    /* the clock is read inside the counted part, not around the
+     * perf_event_open calls */
+    if ( micro_perf ) ctPerf_open( &c->perf );
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    c->seconds = t.tv_sec + 1e-9 * t.tv_nsec;
+    if ( !micro_perf ) c->cycles = micro_tsc();
+}
+
+
+/* Print the cost of ops operations since c started. */
+static
+void
+micro_report( microClock * c, const char * name, size_t n, size_t ops )
+{
+    struct timespec t;
+    double cycles, seconds;
+
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    seconds = t.tv_sec + 1e-9 * t.tv_nsec - c->seconds;
+    if ( micro_perf ) {
+        double counts[CT_NUM_EVENTS] = { 0 };
+        int counted[CT_NUM_EVENTS] = { 0 };
+        ctPerf_close( &c->perf, counts, counted );
+        cycles = counted[CT_EVENT_CYCLES] ? counts[CT_EVENT_CYCLES] : -1;
+    } else {
+        cycles = micro_tsc();
+        if ( cycles >= 0 ) cycles -= c->cycles;
+    }
+
+    if ( ops == 0 ) ops = 1;
+    if ( cycles < 0 ) printf( "%-44s %10lu %12s", name, (unsigned long) n, "-" );
+    else printf( "%-44s %10lu %12.1f", name, (unsigned long) n, cycles / ops );
+    printf( " %10.2f\n", 1e9 * seconds / ops );
+    fflush( stdout );
+}
+
+
+/* xorshift32, so runs are the same everywhere */
+static unsigned long micro_state = 2463534242UL;
+
+static
+size_t
+micro_random( size_t n )
+{
+    unsigned long x = micro_state;
+    x ^= (x << 13) & 0xffffffffUL;
+    x ^= x >> 17;
+    x ^= (x << 5) & 0xffffffffUL;
+    micro_state = x;
+    return (size_t) ( (double) x / 4294967296.0 * n );
+}
+
+
+/* Union-find on join/split components. */
+static
+void
+micro_components( size_t n )
+{
+    ctComponentStore cs;
+    microClock c;
+    size_t i, sum = 0;
+
+    ctComponentStore_init( &cs, CT_JOIN_COMPONENT );
+    for ( i = 0; i < n; i++ ) ctComponent_new( &cs );
+
+    /* each joins the next, as along a path; union by rank keeps it flat */
+    micro_start( &c );
+    for ( i = 0; i+1 < n; i++ ) ctComponent_union( &cs, i, i+1 );
+    micro_report( &c, "ctComponent_union, chain", n, n-1 );
+    micro_start( &c );
+    for ( i = 0; i < n; i++ ) sum += ctComponent_find( &cs, i );
+    micro_report( &c, "ctComponent_find, after chain", n, n );
+    ctComponentStore_clear( &cs );
+
+    ctComponentStore_init( &cs, CT_JOIN_COMPONENT );
+    for ( i = 0; i < n; i++ ) ctComponent_new( &cs );
+    micro_start( &c );
+    for ( i = 0; i < n; i++ ) ctComponent_union( &cs, micro_random(n), micro_random(n) );
+    micro_report( &c, "ctComponent_union, random", n, n );
+    micro_start( &c );
+    for ( i = 0; i < n; i++ ) sum += ctComponent_find( &cs, micro_random(n) );
+    micro_report( &c, "ctComponent_find, random", n, n );
+    ctComponentStore_clear( &cs );
+
+    if ( sum == 1 ) printf( "\n" );
+}
+
+
+/* Union-find on arcs, which has no union by rank. */
+static
+void
+micro_arcs( size_t n )
+{
+    ctArc *arcs = (ctArc*) calloc( n, sizeof(ctArc) );
+    microClock c;
+    size_t i, sum = 0;
+
+    /* a chain n long, which the first find has to walk all of */
+    for ( i = 0; i < n; i++ ) arcs[i].uf = &arcs[i];
+    for ( i = 0; i+1 < n; i++ ) ctArc_union( &arcs[i], &arcs[i+1] );
+    micro_start( &c );
+    sum += ctArc_find( &arcs[0] ) - arcs;
+    micro_report( &c, "ctArc_find, head of chain", n, 1 );
+    micro_start( &c );
+    for ( i = 0; i < n; i++ ) sum += ctArc_find( &arcs[i] ) - arcs;
+    micro_report( &c, "ctArc_find, chain after compression", n, n );
+
+    /* root of one random tree under the root of another, as the merge does */
+    for ( i = 0; i < n; i++ ) arcs[i].uf = &arcs[i];
+    micro_start( &c );
+    for ( i = 0; i < n; i++ ) {
+        ctArc *a = ctArc_find( &arcs[micro_random(n)] );
+        ctArc *b = ctArc_find( &arcs[micro_random(n)] );
+        if ( a != b ) ctArc_union( a, b );
+    }
+    micro_report( &c, "ctArc_find x2 + ctArc_union, random", n, n );
+    micro_start( &c );
+    for ( i = 0; i < n; i++ ) sum += ctArc_find( &arcs[micro_random(n)] ) - arcs;
+    micro_report( &c, "ctArc_find, random", n, n );
+
+    free( arcs );
+    if ( sum == 1 ) printf( "\n" );
+}
+
+
+static
+void
+micro_leafQueue( size_t n )
+{
+    ctLeafQ *q;
+    microClock c;
+    size_t i, sum = 0;
+
+    /* from the smallest size, so it grows by re-pushing everything */
+    q = ctLeafQ_new( 1 );
+    micro_start( &c );
+    for ( i = 0; i < n; i++ ) ctLeafQ_pushBack( q, i, CT_JOIN_COMPONENT );
+    micro_report( &c, "ctLeafQ_pushBack, growing from 16", n, n );
+    micro_start( &c );
+    while ( !ctLeafQ_isEmpty( q ) ) sum += ctLeafQ_popFront( q ).c;
+    micro_report( &c, "ctLeafQ_popFront", n, n );
+    ctLeafQ_delete( q );
+
+    q = ctLeafQ_new( n+1 );
+    micro_start( &c );
+    for ( i = 0; i < n; i++ ) ctLeafQ_pushBack( q, i, CT_JOIN_COMPONENT );
+    micro_report( &c, "ctLeafQ_pushBack, presized", n, n );
+    ctLeafQ_delete( q );
+
+    if ( sum == 1 ) printf( "\n" );
+}
+
+
+/* The queue of ct_decompose, on a star: n maxima over one saddle, so the
+ * priority of each is its height above the saddle. */
+static
+void
+micro_priorityQueue( size_t n )
+{
+    size_t numVerts = n+1, i;
+    ctIndex *order = (ctIndex*) malloc( numVerts * sizeof(ctIndex) );
+    double *values = (double*) malloc( numVerts * sizeof(double) );
+    size_t offsets[2] = { 0, 0 };
+    ctIndex adjacency[1] = { 0 };
+    ctNode **leaves = (ctNode**) malloc( n * sizeof(ctNode*) );
+    ctContext *ctx;
+    ctPriorityQ *pq;
+    ctNode *center;
+    microClock c;
+
+    for ( i = 0; i < numVerts; i++ ) order[i] = i;
+    values[0] = 0;
+    ctx = ct_initCSR( numVerts, order, offsets, adjacency, values );
+    center = ctNode_new( 0, ctx );
+    for ( i = 0; i < n; i++ ) {
+        ctArc *a;
+        values[i+1] = 1 + micro_random( n );
+        leaves[i] = ctNode_new( i+1, ctx );
+        a = ctArc_new( leaves[i], center, ctx );
+        ctNode_addDownArc( leaves[i], a );
+        ctNode_addUpArc( center, a );
+    }
+
+    pq = ctPriorityQ_new();
+    micro_start( &c );
+    for ( i = 0; i < n; i++ ) ctPriorityQ_push( pq, leaves[i], ctx );
+    micro_report( &c, "ctPriorityQ_push, random", n, n );
+
+    /* move each to a new random place, as collapsing arcs does */
+    micro_start( &c );
+    for ( i = 0; i < n; i++ ) {
+        leaves[i]->value = 1 + micro_random( n );
+        ctPriorityQ_push( pq, leaves[i], ctx );
+    }
+    micro_report( &c, "ctPriorityQ_push, update in place", n, n );
+
+    micro_start( &c );
+    while ( !ctPriorityQ_isEmpty( pq ) ) ctPriorityQ_pop( pq, ctx );
+    micro_report( &c, "ctPriorityQ_pop", n, n );
+
+    /* each new one is the least, so it goes all the way up */
+    for ( i = 0; i < n; i++ ) leaves[i]->value = (double) (n - i);
+    micro_start( &c );
+    for ( i = 0; i < n; i++ ) ctPriorityQ_push( pq, leaves[i], ctx );
+    micro_report( &c, "ctPriorityQ_push, descending", n, n );
+
+    ctPriorityQ_clear( pq );
+    ctPriorityQ_delete( pq );
+    ct_cleanup( ctx );
+    free( leaves );
+    free( values );
+    free( order );
+}
+
+
+static
+void
+micro_nodeMap( size_t n )
+{
+    size_t numVerts = 16*n, i, hits = 0;
+    ctNode *nodes = (ctNode*) calloc( n, sizeof(ctNode) );
+    int compact;
+
+    /* the array map of small meshes, then the hash table of big ones */
+    for ( compact = 0; compact < 2; compact++ ) {
+        ctNodeMap *m = ctNodeMap_new( numVerts, compact );
+        microClock c;
+
+        micro_state = 2463534242UL;
+        micro_start( &c );
+        for ( i = 0; i < n; i++ ) {
+            nodes[i].i = micro_random( numVerts );
+            if ( !ctNodeMap_find( m, nodes[i].i ) ) ctNodeMap_insert( m, nodes[i].i, &nodes[i] );
+        }
+        micro_report( &c, compact ? "ctNodeMap_find + insert, hash" 
+                                  : "ctNodeMap_find + insert, array", n, n );
+        micro_start( &c );
+        for ( i = 0; i < n; i++ ) hits += ctNodeMap_find( m, nodes[micro_random(n)].i ) != NULL;
+        micro_report( &c, compact ? "ctNodeMap_find, hit, hash" 
+                                  : "ctNodeMap_find, hit, array", n, n );
+        micro_start( &c );
+        for ( i = 0; i < n; i++ ) hits += ctNodeMap_find( m, micro_random( numVerts ) ) != NULL;
+        micro_report( &c, compact ? "ctNodeMap_find, mostly miss, hash" 
+                                  : "ctNodeMap_find, mostly miss, array", n, n );
+        ctNodeMap_delete( m );
+    }
+
+    free( nodes );
+    if ( hits == 1 ) printf( "\n" );
+}
+
+
+static
+void
+micro_branchLists( size_t n )
+{
+    ctBranch *branches = (ctBranch*) calloc( 2*n + 1, sizeof(ctBranch) );
+    ctBranch *root = &branches[2*n];
+    ctBranchList a, b;
+    microClock c;
+    size_t i;
+
+    /* in ascending order, so each add walks the whole list */
+    for ( i = 0; i < n; i++ ) branches[i].saddleValue = (double) i;
+    a = ctBranchList_init();
+    micro_start( &c );
+    for ( i = 0; i < n; i++ ) ctBranchList_add( &a, &branches[i], NULL );
+    micro_report( &c, "ctBranchList_add, ascending", n, n );
+
+    /* every other one, so the merge alternates */
+    for ( i = 0; i < n; i++ ) branches[n+i].saddleValue = i + 0.5;
+    b = ctBranchList_init();
+    for ( i = 0; i < n; i++ ) ctBranchList_add( &b, &branches[2*n-1-i], NULL );
+    micro_start( &c );
+    ctBranchList_merge( &a, &b, NULL );
+    micro_report( &c, "ctBranchList_merge, interleaved", n, 2*n );
+
+    /* what ct_decompose does instead: push in any order, sort once */
+    for ( i = 0; i < 2*n; i++ ) branches[i].saddleValue = (double) micro_random( 2*n );
+    root->children = ctBranchList_init();
+    micro_start( &c );
+    for ( i = 0; i < 2*n; i++ ) ctBranchList_push( &root->children, &branches[i] );
+    ctBranch_sortChildren( root, NULL );
+    micro_report( &c, "ctBranchList_push + ctBranch_sortChildren", 2*n, 2*n );
+
+    free( branches );
+}
+
+
+int
+main( int argc, char ** argv )
+{
+    size_t n = 1 << 20, listSize = 1 << 12;
+    int a;
+
+    for ( a = 1; a < argc; a++ ) {
+        if ( a+1 < argc && strcmp( argv[a], "--n" ) == 0 ) n = atol( argv[++a] );
+        else if ( a+1 < argc && strcmp( argv[a], "--list" ) == 0 ) listSize = atol( argv[++a] );
+        else {
+            fprintf( stderr, "usage: micro [--n N] [--list N]\n"
+                "  N elements for each structure (default 1048576), and for the\n"
+                "  quadratic ctBranchList_add (default 4096)\n" );
+            return 2;
+        }
+    }
+    if ( n < 2 ) n = 2;
+
+    {   /* count cycles with perf_event_open if this machine lets us */
+        ctPerf p;
+        double counts[CT_NUM_EVENTS] = { 0 };
+        int counted[CT_NUM_EVENTS] = { 0 };
+        ctPerf_open( &p );
+        micro_perf = p.fd[CT_EVENT_CYCLES] >= 0;
+        ctPerf_close( &p, counts, counted );
+    }
+    printf( "cycles from %s\n", micro_perf ? "perf_event_open" : 
+        micro_tsc() >= 0 ? "the time stamp counter" : "nowhere" );
+    printf( "%-44s %10s %12s %10s\n", "benchmark", "n", "cycles/op", "ns/op" );
+    micro_components( n );
+    micro_arcs( n );
+    micro_leafQueue( n );
+    micro_priorityQueue( n );
+    micro_nodeMap( n );
+    micro_branchLists( listSize );
+    return 0;
+}
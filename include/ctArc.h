@@ -92,6 +92,11 @@ typedef struct ctArc
 	/** Union-find pointer. Don't touch. */
 	struct ctArc * uf;
 
+	/** One of the vertices mapped to this arc, and how many there are,
+	 * kept while a simplifying merge runs. Don't touch. */
+	ctIndex vertex;
+	ctIndex numVertices;
+
 
 } ctArc;
 
@@ -37,6 +37,7 @@ This file defines the ctBranch structure, which forms the branch decomposition.
 */
 
 #include <stdlib.h> /* size_t */
+#include "ctIndex.h"
 
 struct ctBranch;
 struct ctContext;
@@ -71,10 +72,19 @@ typedef struct ctBranchList
 typedef struct ctBranch
 {
 	/** Extremal vertex. Could be a minimum or a maximum critical point. */
-	size_t extremum;
+	ctIndex extremum;
 
 	/** Saddle vertex. */
-	size_t saddle;
+	ctIndex saddle;
+
+	/** Function value of saddle. Set by ct_decompose, which keeps child
+	 * lists in order of it. For branches built by hand, ctBranch_new sets
+	 * it, so that ctBranchList_add and ctBranchList_merge order them the
+	 * same way. */
+	double saddleValue;
+
+	/** Function value of extremum. Set by ctBranch_new. */
+	double extremumValue;
 
 	/** Parent branch, where saddle is attached. */
 	struct ctBranch *parent;
@@ -100,8 +110,8 @@ ctBranchList  ctBranchList_init   ();
 
 /**
  * Add branch br to a branch list. br will be inserted in order of ascending
- * function value of the saddle. The order does \em not respect the total order
- * provided \ref ct_init
+ * saddleValue, then saddle vertex, then extremum vertex.
+ * The order does \em not respect the total order provided \ref ct_init
  **/
 void  ctBranchList_add    ( ctBranchList * self, ctBranch * br, struct ctContext * ctx );
 
@@ -111,13 +121,36 @@ void  ctBranchList_remove ( ctBranchList * self, ctBranch * br );
 /** Merge two sorted branch lists. */
 void  ctBranchList_merge  ( ctBranchList * self, ctBranchList * other, struct ctContext * ctx );
 
+/**
+ * Add branch br to the front of a list, in no order. Such lists are sorted
+ * by \ref ctBranch_sortChildren. Until then, head->prevChild is the last
+ * branch of the list, so that ctBranchList_append doesn't walk it.
+ **/
+void  ctBranchList_push   ( ctBranchList * self, ctBranch * br );
+
+/** Put the branches of other after those of self. Both are unsorted lists
+ * made by ctBranchList_push. */
+void  ctBranchList_append ( ctBranchList * self, ctBranchList * other );
+
+/**
+ * Sort the unsorted child lists of root and all its descendants into the
+ * order of ctBranchList_add: ascending function value of the saddle, then
+ * saddle vertex, then extremum vertex. ctx may be NULL; it is only used to
+ * count the work for ct_stats.
+ **/
+void  ctBranch_sortChildren ( ctBranch * root, struct ctContext * ctx );
+
 /**
  * Allocate a new branch using the allocator specified by \ref
- * ct_branchAllocator
+ * ct_branchAllocator. Its saddleValue and extremumValue are the function
+ * values of saddle and extremum.
  **/
-ctBranch*  ctBranch_new    ( size_t extremum, size_t saddle, struct ctContext* ctx );
+ctBranch*  ctBranch_new    ( ctIndex extremum, ctIndex saddle, struct ctContext* ctx );
 
-/** Delete a branch using the deallocator specified by \ref ct_branchAllocator */
+/**
+ * Delete a branch and all its descendants using the deallocator specified by
+ * \ref ct_branchAllocator
+ **/
 void  ctBranch_delete ( ctBranch * self, struct ctContext* ctx );
 
 
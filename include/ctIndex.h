@@ -0,0 +1,53 @@
+/*
+Copyright (c) 2006, Scott E. Dillard
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef CT_INDEX_H
+#define CT_INDEX_H
+
+/**
+\file ctIndex.h
+
+\brief Defines ctIndex, the type of vertex indexes.
+
+Vertex indexes are size_t unless the library is built with CT_INDEX_32
+defined, in which case they are 32-bit unsigned integers. That halves the
+library's per-vertex working memory, but limits you to a little under 4G
+vertices. Your program must be compiled with the same setting as the
+library, since it changes the types in the API.
+*/
+
+#include <stdlib.h> /* size_t */
+
+#ifdef CT_INDEX_32
+/** Vertex index. */
+typedef unsigned int ctIndex;
+#else
+/** Vertex index. */
+typedef size_t ctIndex;
+#endif
+
+#endif
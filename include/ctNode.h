@@ -38,6 +38,7 @@ This file defines the ctNode structure and functions to manipulate the contour t
 
 
 #include <stdlib.h> /* size_t */
+#include "ctIndex.h"
 #include "ctBranch.h"
 
 struct ctArc;
@@ -54,7 +55,10 @@ struct ctContext;
 typedef struct ctNode
 {
 	/** Critical vertex that this node represents. */
-	size_t i;
+	ctIndex i;
+
+	/** Function value of i, looked up once when the node is made. */
+	double value;
 
 	/** Doubly-linked, null-terminated list of arcs extended upwards from this node. Iterate like this:
 
@@ -71,12 +75,15 @@ typedef struct ctNode
 	/** \internal Temporary storage for child branches. Used by ct_decompose. Don't access this. */
 	ctBranchList children;
 
+	/** \internal Position in the priority queue of ct_decompose, CT_NIL if not in it. Don't access this. */
+	ctIndex heapPos;
+
 	/** User data */
 	void * data;
 } ctNode;
 
 /** Allocate a new node using the allocator specified by \ref ct_nodeAllocator */
-ctNode*  ctNode_new           ( size_t i, struct ctContext* ctx );
+ctNode*  ctNode_new           ( ctIndex i, struct ctContext* ctx );
 
 /** Delete a node using the deallocator specified by \ref ct_nodeAllocator*/
    void  ctNode_delete        ( ctNode* self, struct ctContext* ctx );
@@ -35,6 +35,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <stdlib.h> /* size_t */
 
+#include "ctIndex.h"
+
 #include "ctArc.h"
 #include "ctBranch.h"
 #include "ctNode.h"
@@ -48,9 +50,9 @@ typedef struct ctContext ctContext;
 
 /**
 Call this first. This function provides the needed data and callbacks to the
-library, so that it can compute the contour tree of your...whatever it is. This
-also allocates the working memory for the library. The corresponding
-deallocation function is ct_cleanup
+library, so that it can compute the contour tree of your...whatever it is.
+Working memory is allocated later, by the phases that need it. The
+corresponding deallocation function is ct_cleanup
 
 @param numVertices     Number of vertices in the mesh
 
@@ -70,14 +72,161 @@ deallocation function is ct_cleanup
 
 ctContext * ct_init(
     size_t  numVertices,
-    size_t  *totalOrder,
-    double  (*value)( size_t v, void* ),
-    size_t  (*neighbors)( size_t v, size_t* nbrs, void* ),
+    ctIndex *totalOrder,
+    double  (*value)( ctIndex v, void* ),
+    size_t  (*neighbors)( ctIndex v, ctIndex* nbrs, void* ),
+    void*  data
+);
+
+
+/**
+Like ct_init, but the mesh is given as a compressed-sparse-row adjacency
+and the function values as an array, so the library never has to call back
+into your code to get neighbors or values. The arrays are not copied, so
+keep them around until ct_cleanup.
+
+@param numVertices     Number of vertices in the mesh
+
+@param totalOrder      Array of vertex indexes, in sorted order.
+
+@param offsets         Array of numVertices+1 offsets into adjacency. The
+                       neighbors of vertex v are adjacency[offsets[v]] through
+                       adjacency[offsets[v+1]-1].
+
+@param adjacency       Concatenated neighbor lists of all vertices.
+
+@param values          Function value of each vertex. Used only for
+                       estimating persistence of arcs.
+*/
+
+ctContext * ct_initCSR(
+    size_t  numVertices,
+    ctIndex *totalOrder,
+    size_t  *offsets,
+    ctIndex *adjacency,
+    double  *values
+);
+
+
+
+/** \brief Neighborhoods for ct_initGrid. */
+typedef enum ctGridConnectivity
+{
+    /** 2D, edge neighbors. */
+    CT_GRID_4,
+    /** 2D, edge and corner neighbors. */
+    CT_GRID_8,
+    /** 3D, face neighbors. */
+    CT_GRID_6,
+    /** 3D, face and edge neighbors. */
+    CT_GRID_18,
+    /** 3D, face, edge and corner neighbors. */
+    CT_GRID_26,
+    /**
+     * The Freudenthal triangulation of the grid: 6 neighbors in 2D, 14 in
+     * 3D. This is a proper simplicial mesh, so it is the one to use if you
+     * don't have a reason to pick another.
+     **/
+    CT_GRID_FREUDENTHAL
+} ctGridConnectivity;
+
+
+/**
+Like ct_init, but for a regular 2D or 3D grid. The library generates the
+neighbors of each vertex itself, so there is no neighbors callback.
+
+@param dims            Grid size. Vertex (x,y,z) has index
+                       x + dims[0]*(y + dims[1]*z). Use dims[2] = 1 for 2D.
+
+@param connectivity    Which neighbors a vertex has. See ctGridConnectivity.
+
+@param totalOrder      Array of vertex indexes, in sorted order.
+
+@param value           Callback to get function value of a vertex v. Used only
+                       for estimating persistence of arcs.
+
+@param data            User data passed to all callbacks.
+*/
+
+ctContext * ct_initGrid(
+    size_t  dims[3],
+    ctGridConnectivity connectivity,
+    ctIndex *totalOrder,
+    double  (*value)( ctIndex v, void* ),
     void*  data
 );
 
 
 
+/** \brief Element types of the value arrays taken by ct_initFromValues. */
+typedef enum ctValueType
+{
+    CT_VALUE_UINT8,   /**< unsigned char */
+    CT_VALUE_UINT16,  /**< unsigned short */
+    CT_VALUE_FLOAT,   /**< float, no NaNs */
+    CT_VALUE_DOUBLE   /**< double, no NaNs */
+} ctValueType;
+
+
+/**
+Sort the vertices by value, ties broken by index, which is the total order
+ct_init and friends expect. 8 and 16 bit values are sorted with a single
+counting pass; floats and doubles with a radix sort on as many threads as
+ct_numThreads allows, one per core by default.
+-0 and +0 count as equal.
+
+@param values          Function value of each vertex, numVertices of them.
+
+@param type            What values holds.
+
+@param totalOrder      Output, room for numVertices indexes.
+*/
+
+void ct_sortVertices(
+    const void *values,
+    ctValueType type,
+    size_t  numVertices,
+    ctIndex *totalOrder
+);
+
+
+/**
+ * Limit the threads that ct_sortVertices, ct_sweepAndMergeParallel and
+ * ct_batch use, for all contexts. With 1 everything runs on the calling
+ * thread. 0, the default, means one per core. Set it while none of them
+ * is running.
+ **/
+void ct_numThreads( size_t n );
+
+
+/**
+Like ct_init, but the library sorts the vertices itself, from an array of
+function values. The array is not copied, so keep it around until
+ct_cleanup. The total order is owned by the library and freed by
+ct_cleanup. For a grid or CSR mesh, call ct_sortVertices and pass its result
+to ct_initGrid or ct_initCSR.
+
+@param values          Function value of each vertex. Also used for
+                       estimating persistence of arcs.
+
+@param type            What values holds.
+
+@param numVertices     Number of vertices in the mesh
+
+@param neighbors       As for ct_init.
+
+@param data            User data passed to neighbors.
+*/
+
+ctContext * ct_initFromValues(
+    const void *values,
+    ctValueType type,
+    size_t  numVertices,
+    size_t  (*neighbors)( ctIndex v, ctIndex* nbrs, void* ),
+    void*  data
+);
+
+
 
 
 
@@ -92,6 +241,15 @@ ctContext * ct_init(
  **/
 void ct_maxValence( ctContext * ctx, size_t max );
 
+/**
+ * Use a neighbors callback that is also told which worker is calling it: 0
+ * for the join sweep and 1 for the split sweep. This replaces the neighbors
+ * callback given to ct_init. Use it to keep separate scratch space per worker
+ * if you run the sweeps concurrently, with ct_sweepAndMergeParallel or your
+ * own threads.
+ **/
+void ct_workerNeighborsFunc( ctContext * ctx, size_t (*neighbors)( ctIndex v, ctIndex* nbrs, size_t worker, void* ) );
+
 /**
  * Process a vertex in the sweepAndMerge algorithm. This is called when the
  * arc belonging to v is added to the contour tree. One use for this might be
@@ -102,7 +260,7 @@ void ct_maxValence( ctContext * ctx, size_t max );
  * href="http://citeseer.ist.psu.edu/bajaj98contour.html">path seed</a> for
  * arc a.  It will be called many times for the "big, important arcs."
  **/
-void ct_vertexFunc( ctContext * ctx, void (*vertexFunc)( size_t v, ctArc* a, void* ) );
+void ct_vertexFunc( ctContext * ctx, void (*vertexFunc)( ctIndex v, ctArc* a, void* ) );
 
 
 /**
@@ -124,27 +282,202 @@ void ct_arcMergeFunc( ctContext * ctx, void (*arcMergeFunc)( ctArc* a, ctArc* b,
  **/
 void ct_priorityFunc( ctContext * ctx, double (*priorityFunc)( ctNode*, void* ) );
 
+/**
+ * Simplify the contour tree while it is built. The merge cancels leaves
+ * whose priority (see ct_priorityFunc, persistence by default) is below
+ * threshold as it finds them, wherever another arc beside the leaf is sure
+ * to outlast it, and when it is done it prunes the rest below threshold in
+ * priority order, as ct_decompose would. A leaf's vertices go to the arc
+ * beside it, saddles left with one arc up and one down are removed, and
+ * ct_arcMap maps into the simplified tree, so the small features never
+ * reach ct_decompose. Cancelled arcs and nodes are freed as the merge
+ * goes, which costs an extra index per vertex while it runs. Call before
+ * the merge.
+ **/
+void ct_simplifyThreshold( ctContext * ctx, double threshold );
+
 
 
 /**
  * Provide your own alloc/free functions for ctArc structures. You will need
- * to use these if you want to subclass ctArc.
+ * to use these if you want to subclass ctArc. By default arcs and nodes come
+ * from slab arenas, one per tree, which lets ct_deleteTree free a tree all at
+ * once. Pass NULL for both functions to go back to that.
  **/
 void ct_arcAllocator( ctContext * ctx, ctArc* (*allocArc)(void*), void (*freeArc)( ctArc*, void*) );
 
 /**
  * Provide your own alloc/free functions for ctNode structures. You will need
- * to use this if you want to sublcass ctNode.
+ * to use this if you want to sublcass ctNode. Pass NULL for both functions to
+ * use the default arena.
  **/
 void ct_nodeAllocator( ctContext * ctx, ctNode* (*allocNode)(void*) , void (*freeNode)( ctNode*, void*) );
 
 /**
  * Provide your own alloc/free functions for ctBranch structures. You will need
- * to use this if you want to sublcass ctBranch.
+ * to use this if you want to sublcass ctBranch. By default each branch
+ * decomposition gets a slab arena of its own; see ct_deleteBranchTree. Pass
+ * NULL for both functions to go back to that.
  **/
 void ct_branchAllocator( ctContext * ctx, ctBranch* (*allocBranch)(void*), void (*freeBranch)( ctBranch*, void*) );
 
 
+/** The kinds of memory counted by ct_memoryStats. **/
+typedef enum ctMemCategory
+{
+    CT_MEM_VERTEX_ARRAYS, /**< per-vertex working arrays used by the sweeps */
+    CT_MEM_COMPONENTS,    /**< join and split tree components */
+    CT_MEM_NODE_MAP,      /**< vertex-to-node map */
+    CT_MEM_ARCS,          /**< ctArc structures */
+    CT_MEM_NODES,         /**< ctNode structures */
+    CT_MEM_BRANCHES,      /**< ctBranch structures */
+    CT_MEM_QUEUES,        /**< leaf queue and priority queue */
+    CT_MEM_OUTPUT_MAPS,   /**< arc map and branch map */
+    CT_MEM_NUM_CATEGORIES
+} ctMemCategory;
+
+/**
+ * Bytes of memory held by the library, per ctMemCategory. Arcs, nodes and
+ * branches are counted at their sizeof, even with a custom allocator. The
+ * arc and branch maps stop being counted once you take them with ct_arcMap
+ * or ct_branchMap.
+ **/
+typedef struct ctMemoryStats
+{
+    size_t current[CT_MEM_NUM_CATEGORIES]; /**< held right now */
+    size_t peak[CT_MEM_NUM_CATEGORIES];    /**< most ever held at once */
+    size_t total;     /**< sum of current */
+    size_t totalPeak; /**< most ever held at once, all categories together */
+    size_t budget;    /**< as given to ct_memoryBudget, 0 if none */
+} ctMemoryStats;
+
+/**
+ * Report the memory held by the library for this context, now and at its
+ * peak. Working memory is allocated when the phase that needs it starts and
+ * released as soon as the last phase that reads it is done, so the peak is
+ * usually reached during ct_mergeTrees.
+ **/
+ctMemoryStats ct_memoryStats( ctContext * ctx );
+
+
+
+/** \brief Phases timed by ct_stats. */
+typedef enum ctPhase
+{
+    CT_PHASE_SORT,        /**< sorting by ct_initFromValues and ct_resetValues */
+    CT_PHASE_JOIN_SWEEP,  /**< ct_joinSweep */
+    CT_PHASE_SPLIT_SWEEP, /**< ct_splitSweep */
+    CT_PHASE_AUGMENT,     /**< first half of ct_mergeTrees */
+    CT_PHASE_MERGE,       /**< second half of ct_mergeTrees */
+    CT_PHASE_DECOMPOSE,   /**< ct_decompose, up to the branch map */
+    CT_PHASE_BRANCH_MAP,  /**< the branch map, at the end of ct_decompose */
+    CT_NUM_PHASES
+} ctPhase;
+
+/** \brief Hardware events counted by ct_hardwareCounters. */
+typedef enum ctEvent
+{
+    CT_EVENT_CYCLES,        /**< CPU cycles */
+    CT_EVENT_INSTRUCTIONS,  /**< instructions retired */
+    CT_EVENT_LLC_MISSES,    /**< last level cache misses on loads */
+    CT_EVENT_DTLB_MISSES,   /**< data TLB misses on loads */
+    CT_EVENT_BRANCH_MISSES, /**< mispredicted branches */
+    CT_NUM_EVENTS
+} ctEvent;
+
+/** \brief What ct_stats counts for each sweep. */
+typedef struct ctSweepStats
+{
+    size_t extrema;         /**< components born at a vertex with no swept neighbors */
+    size_t saddles;         /**< vertices where components joined */
+    size_t augmented;       /**< components spliced in by ct_mergeTrees */
+    size_t finds;           /**< union-find lookups */
+    size_t findSteps;       /**< links followed by those lookups */
+    size_t neighborCalls;   /**< calls to the neighbors callback */
+    double neighborSeconds; /**< time spent in them */
+} ctSweepStats;
+
+/**
+ * \brief Timings and counters from ct_stats.
+ *
+ * Everything adds up over all the runs of a context, until ct_clearStats.
+ **/
+typedef struct ctStats
+{
+    /** 0 if the library was built without CT_STATS, and the rest is 0 too. */
+    int enabled;
+
+    /** Wall clock seconds, per ctPhase. */
+    double seconds[CT_NUM_PHASES];
+
+    /** The join sweep, then the split sweep. */
+    ctSweepStats sweep[2];
+
+    /** Union-find lookups on arcs, and the links they followed. */
+    size_t arcFinds;
+    size_t arcFindSteps;
+
+    /** Times the leaf queue of ct_mergeTrees had to grow. */
+    size_t leafQueueGrowths;
+
+    /** Leaves of ct_decompose whose priority changed while they were queued. */
+    size_t priorityUpdates;
+
+    /** Steps taken putting branches in order in child lists. */
+    size_t branchListSteps;
+
+    /** Hardware events per ctPhase and ctEvent, if ct_hardwareCounters is on. */
+    double events[CT_NUM_PHASES][CT_NUM_EVENTS];
+
+    /** 1 for each ctEvent that was counted at all; the others stay 0 in events. */
+    int eventCounted[CT_NUM_EVENTS];
+} ctStats;
+
+/**
+ * Report where the time went, and how much work the inner loops did. Timing
+ * and counting cost a little, so they are only done if the library was
+ * built with CT_STATS defined, for instance with make CT_STATS=1.
+ * Otherwise they aren't compiled in at all, and this returns zeros.
+ **/
+ctStats ct_stats( ctContext * ctx );
+
+/** Set the counts and times of ct_stats back to 0. */
+void ct_clearStats( ctContext * ctx );
+
+/**
+ * Count hardware events around each phase too, if on is nonzero, and
+ * report them through ct_stats. This needs a CT_STATS build on Linux, and
+ * perf_event_open has to be allowed: see perf_event_paranoid. The counters
+ * follow the thread that runs a phase and the threads it starts, so each
+ * sweep of ct_sweepAndMergeParallel counts only itself. Returns how many of
+ * the CT_NUM_EVENTS events can be counted here, 0 if none can; the ones
+ * that can't are left out of ct_stats, and nothing else changes. Off by
+ * default.
+ **/
+int ct_hardwareCounters( ctContext * ctx, int on );
+
+/**
+ * Ask the library to keep its memory use under this many bytes, where it has
+ * a choice. With a budget the component stores grow in smaller steps and are
+ * trimmed when a sweep ends, trading some speed for a lower peak. The budget
+ * is a hint, not a limit: the tree itself is always allocated. If the
+ * per-vertex arrays alone would not fit, they go out of core as with
+ * ct_outOfCore, in $TMPDIR or /tmp. 0, the default, means no budget.
+ **/
+void ct_memoryBudget( ctContext * ctx, size_t bytes );
+
+/**
+ * Keep the per-vertex working arrays and the arc and branch maps in files
+ * under scratchDir instead of in memory, for meshes whose arrays don't fit
+ * in RAM. The files are mapped and unlinked as soon as they are made, so
+ * nothing is left behind. NULL means $TMPDIR, or /tmp if that is unset. If
+ * a file can't be made, that array falls back to malloc. The maps you get
+ * from ct_arcMap and ct_branchMap may then be mapped files: release them
+ * with ct_freeMap, not free(). Call before the sweeps.
+ **/
+void ct_outOfCore( ctContext * ctx, const char * scratchDir );
+
+
 
 
 /**
@@ -156,6 +489,18 @@ void ct_branchAllocator( ctContext * ctx, ctBranch* (*allocBranch)(void*), void
 ctArc* ct_sweepAndMerge( ctContext * ctx );
 
 
+/**
+ * Same as ct_sweepAndMerge, but the join and split sweeps run concurrently
+ * on two threads, and the scan that augments the two trees with each
+ * other's nodes is split over all the processors, or as many threads as
+ * ct_numThreads allows. With 1 the sweeps run one after the other. Each
+ * sweep has its own neighbor buffer, but they call your neighbors callback
+ * at the same time, so it must be reentrant. If it needs scratch space, use
+ * ct_workerNeighborsFunc to keep one per worker.
+ **/
+ctArc* ct_sweepAndMergeParallel( ctContext * ctx );
+
+
 /**
  * Perform just the join sweep. The point of calling this would be to
  * also call the split sweep in another thread; they can be performed
@@ -186,7 +531,8 @@ ctArc * ct_mergeTrees( ctContext * ctx );
  * the contour tree, so don't access the contour tree or use ct_arcMap after
  * calling ct_decompose. If you need to keep the contour tree around, use
  * ct_copyTree to make a copy of it. The branch-decomposition tree that is
- * returned is YOURS. The library does not free it when ct_cleanup is called.
+ * returned is YOURS. The library does not free it when ct_cleanup is called;
+ * use ct_deleteBranchTree.
  **/
 ctBranch*  ct_decompose ( ctContext * ctx );
 
@@ -197,6 +543,27 @@ void  ct_cleanup ( ctContext * ctx );
 
 
 
+/**
+ * Get the context ready for another run on the same mesh, such as the next
+ * time step, with a new total order. The contour tree and maps of the
+ * previous run are dropped, but from now on the context keeps its working
+ * memory from one run to the next instead of freeing it, so that runs after
+ * the first don't spend their time in malloc and page faults. ct_cleanup
+ * frees it all. Maps you took with ct_arcMap or ct_branchMap are yours, so
+ * free them first; the next run makes new ones. The branch decomposition
+ * is still yours to delete. 
+ **/
+void ct_reset( ctContext * ctx, ctIndex * totalOrder );
+
+/**
+ * Like ct_reset, but the library sorts the vertices itself from an array of
+ * values, as ct_initFromValues does, into an order that it keeps between
+ * runs.
+ **/
+void ct_resetValues( ctContext * ctx, const void * values, ctValueType type );
+
+
+
 /**
  * Retreive the vertex-to-arc mapping. Returns an array of size equal to
  * ctContext.numVerts, where element i points to the arc which contains vertex
@@ -216,11 +583,19 @@ ctArc ** ct_arcMap( ctContext * ctx );
  * IMPORTANT -- This function needs the arc map to do its thing. Don't modify
  * or free the result of ct_arcMap before calling ct_branchMap.  Ownership of
  * the array is passed to the calling environment. It is your responsibility
- * to free() this. This allows to you call ct_cleanup and still use your
- * branch map.
+ * to free it with ct_freeMap. This allows to you call ct_cleanup and still
+ * use your branch map.
  **/
 ctBranch ** ct_branchMap( ctContext * ctx );
 
+/**
+ * Free a map returned by ct_arcMap or ct_branchMap, whether it lives in
+ * memory or, after ct_outOfCore, in a mapped file. It works after
+ * ct_cleanup too, but call it before a later ct_mergeTrees or ct_decompose
+ * makes a new map.
+ **/
+void ct_freeMap( ctContext * ctx, void * map );
+
 
 
 
@@ -242,7 +617,7 @@ ctBranch ** ct_branchMap( ctContext * ctx );
  * ctArc *newTree = ct_copyTree(oldTree,TRUE,ctx);
  * ctArc **newArcMap = malloc( numVerts * sizeof(ctArc*) );
  * ctArc **oldArcMap = ct_arcMap(ctx);
- * for (size_t i=0; i<numVerts; +i)
+ * for (size_t i=0; i<numVerts; ++i)
  *   newArcMap[i] = oldArcMap[i]->data;
  * \endcode
  *
@@ -267,10 +642,219 @@ void ct_arcsAndNodes( ctArc *a,
 /**
  * Delete a contour tree that you obtained from ct_copyTree. DON'T delete
  * the original tree obtained from ct_sweepAndMerge or ct_mergeTrees; That
- * one belongs to the library and will be freed by ct_cleaup
+ * one belongs to the library and will be freed by ct_cleaup. With the default
+ * allocators this frees the tree's arena, without visiting the tree.
  **/
 void ct_deleteTree( ctArc *a, ctContext *ctx );
 
+/**
+ * Delete the branch decomposition returned by ct_decompose. With the default
+ * allocator this frees its arena all at once, so pass the root, not some
+ * other branch. Otherwise each branch is deleted with ctBranch_delete. For
+ * a tree from ct_batch, pass NULL for ctx.
+ **/
+void ct_deleteBranchTree( ctBranch *root, ctContext *ctx );
+
+
+
+/** 
+ * \brief A contour tree in flat arrays, from ct_freezeTree.
+ *
+ * Nodes and arcs have dense ids, starting at 0. Arcs are numbered by their
+ * lo node, so the arcs going up from node n are the ids upStart[n] to
+ * upStart[n+1]-1. The arcs going down from node n are downArcs[downStart[n]]
+ * to downArcs[downStart[n+1]-1]. There are no pointers between the arrays,
+ * so a frozen tree can be read from any thread, or written out as it is.
+ **/
+typedef struct ctFrozenTree
+{
+    size_t numNodes;
+    size_t numArcs;
+
+    /** Entries in arcMap, or 0 if there is no arcMap. */
+    size_t numVerts;
+
+    /** Per node: its vertex, function value, and ctNode::data. */
+    ctIndex *nodeVertex;
+    double *nodeValue;
+    void **nodeData;
+
+    /** Per node, and one more: the adjacency, as above. */
+    ctIndex *upStart;
+    ctIndex *downStart;
+
+    /** Arc ids, grouped by hi node. */
+    ctIndex *downArcs;
+
+    /** Per arc: the node ids of its ends, and ctArc::data. */
+    ctIndex *arcHi;
+    ctIndex *arcLo;
+    void **arcData;
+
+    /** Per vertex: the id of its arc. */
+    ctIndex *arcMap;
+} ctFrozenTree;
+
+
+/**
+ * Copy the tree that a is part of into flat arrays. If arcMap is not NULL,
+ * it maps each vertex to an arc of the tree, as from ct_arcMap, and the
+ * frozen tree gets the same map by arc id. The data fields are copied as
+ * they are. Call it before ct_decompose, which takes the library's tree
+ * apart. The tree is not changed, and may be deleted afterwards. Free the
+ * result with ct_deleteFrozenTree; it is a single block of memory.
+ **/
+ctFrozenTree* ct_freezeTree( ctContext * ctx, ctArc * a, ctArc ** arcMap );
+
+void ct_deleteFrozenTree( ctFrozenTree * tree );
+
+
+
+/**
+ * \brief A branch decomposition in flat arrays, from ct_freezeBranches.
+ *
+ * Branches are numbered breadth first from the root, which is branch 0, so
+ * the children of branch b are the ids childStart[b] to childStart[b+1]-1,
+ * in the order of their saddle values.
+ **/
+typedef struct ctFrozenBranches
+{
+    size_t numBranches;
+
+    /** Entries in branchMap, or 0 if there is no branchMap. */
+    size_t numVerts;
+
+    /** Per branch: its vertices and their function values, as in ctBranch. */
+    ctIndex *extremum;
+    ctIndex *saddle;
+    double *extremumValue;
+    double *saddleValue;
+
+    /** Per branch: the difference of its two function values. */
+    double *persistence;
+
+    /** Per branch: the id of its parent, or (ctIndex)-1 for the root. */
+    ctIndex *parent;
+
+    /** Per branch, and one more: where its children start, as above. */
+    ctIndex *childStart;
+
+    /** Per branch: ctBranch::data. */
+    void **data;
+
+    /** Per vertex: the id of its branch. */
+    ctIndex *branchMap;
+} ctFrozenBranches;
+
+
+/**
+ * Copy the branch decomposition under root into flat arrays. If branchMap
+ * is not NULL, it has numVerts entries, as from ct_branchMap, and the frozen
+ * branches get the same map by branch id. The branches are not changed.
+ * Free the result with ct_deleteFrozenBranches; it is a single block of
+ * memory.
+ **/
+ctFrozenBranches* ct_freezeBranches( ctBranch * root, ctBranch ** branchMap, size_t numVerts );
+
+void ct_deleteFrozenBranches( ctFrozenBranches * branches );
+
+
+
+/**
+ * Write a frozen tree and frozen branches to a file that ct_mapFile can
+ * load. Either may be NULL. The format is the arrays as they are in memory,
+ * each on a 64 byte boundary, after a header. It is only read on machines
+ * with the same byte order and the same sizes of ctIndex, size_t and double.
+ * The data arrays are pointers, so they are not written. Returns nonzero on
+ * success. On failure, prints why to stderr and returns 0.
+ **/
+int ct_save( const char * path, const ctFrozenTree * tree, const ctFrozenBranches * branches );
+
+
+/** \brief A file written by ct_save, mapped into memory by ct_mapFile. */
+typedef struct ctMappedFile
+{
+    /** The frozen tree, or NULL if none was saved. */
+    const ctFrozenTree *tree;
+
+    /** The frozen branches, or NULL if none were saved. */
+    const ctFrozenBranches *branches;
+} ctMappedFile;
+
+
+/**
+ * Map a file written by ct_save into memory. Only the header is checked:
+ * the arrays point straight into the read-only mapping, and are paged in
+ * as they are used. Their data arrays are NULL. Returns NULL, after
+ * printing why to stderr, if the file can't be opened or wasn't written by
+ * ct_save on a compatible machine. Release it with ct_unmapFile.
+ **/
+ctMappedFile* ct_mapFile( const char * path );
+
+void ct_unmapFile( ctMappedFile * file );
+
+
+
+/** \brief One contour tree for ct_batch. */
+typedef struct ctJob
+{
+    /** Number of vertices in the mesh. */
+    size_t numVertices;
+
+    /** Vertices in sorted order, or NULL to sort values, as ct_sortVertices does. */
+    ctIndex *totalOrder;
+
+    /** Function value of each vertex, of type valueType. If NULL, value is
+     * called instead, and totalOrder must be given. */
+    const void *values;
+    ctValueType valueType;
+    double (*value)( ctIndex v, void* );
+
+    /** The mesh: the neighbors callback if set, as for ct_init, else
+     * csrOffsets and csrAdjacency if set, as for ct_initCSR, else a grid of
+     * size dims, as for ct_initGrid. */
+    size_t (*neighbors)( ctIndex v, ctIndex* nbrs, void* );
+    size_t *csrOffsets;
+    ctIndex *csrAdjacency;
+    size_t dims[3];
+    ctGridConnectivity connectivity;
+
+    /** Maximum valence, see ct_maxValence. 0 means the default. */
+    size_t maxValence;
+
+    /** Optional, see ct_priorityFunc. */
+    double (*priority)( ctNode*, void* );
+
+    /** User data passed to all callbacks. */
+    void *data;
+
+    /** Set this to get branchMap. */
+    int wantBranchMap;
+
+    /** Result: the branch decomposition. Delete it with
+     * ct_deleteBranchTree(root,NULL). */
+    ctBranch *root;
+
+    /** Result: the vertex to branch map, if asked for. free() it, not
+     * ct_freeMap: the batch's contexts never go out of core, so the map is
+     * always plain malloc'd memory, and they are gone when ct_batch
+     * returns. */
+    ctBranch **branchMap;
+} ctJob;
+
+
+/**
+ * Compute the branch decompositions of many independent fields. The jobs
+ * are spread over numThreads threads (0 for as many as ct_numThreads
+ * allows), which take work from each other when they run out, and each
+ * thread keeps one context for all of its jobs, reusing its memory as
+ * ct_reset does. Meant for lots of small fields, where the cost of setting
+ * up a context and running serially would otherwise dominate. The callbacks
+ * may be called from any of the threads, so they must be thread safe.
+ * Contour trees are not kept, and the default allocators are always used.
+ **/
+void ct_batch( ctJob *jobs, size_t numJobs, size_t numThreads );
+
 
 
 
@@ -315,14 +899,16 @@ void ct_deleteTree( ctArc *a, ctContext *ctx );
     the domain to arcs (branches) of the contour tree (branch decomposition),
     which can be very handy.
 
-    The algorithms in the library are serial, but the library is reentrant,
-    should you need to compute another contour tree in one of the callbacks ...
-    or something.
+    The join and split sweeps can run concurrently, see
+    ct_sweepAndMergeParallel(). The rest of the algorithm is serial, but the
+    library is reentrant, should you need to compute another contour tree in
+    one of the callbacks ... or something.
 
     \section Usage
 
-    Include tourtre.h in your program.  Call ct_init() to create a ctContext,
-    then call ct_sweepAndMerge() to create the contour tree and (optionally)
+    Include tourtre.h in your program.  Call ct_init() (or ct_initCSR(), if
+    you have your mesh as an adjacency array, or ct_initGrid() for image and
+    volume data) to create a ctContext, then call ct_sweepAndMerge() to create the contour tree and (optionally)
     ct_decompose() to transform it into a branch decomposition.
 
     The contour tree is made up of \link ctNode nodes \endlink and \link ctArc
@@ -30,7 +30,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 ctArc * ctArc_new(ctNode * h, ctNode * l, ctContext * ctx)
 {
-	ctArc * a = (*(ctx->arcAlloc))(ctx->cbData);
+	ctArc * a;
+	if (ctx->arcAlloc) a = (*(ctx->arcAlloc))(ctx->cbData);
+	else a = (ctArc*) ctArena_alloc( &ct_treeArena(ctx)->arcs );
+	ctMemory_add( &ctx->mem, CT_MEM_ARCS, sizeof(ctArc) );
 	a->hi = h;
 	a->lo = l;
 	a->nextUp = a->nextDown = a->prevUp = a->prevDown = NULL;
@@ -38,12 +41,16 @@ ctArc * ctArc_new(ctNode * h, ctNode * l, ctContext * ctx)
 	a->children = ctBranchList_init();
 	a->uf = a;
 	a->data = NULL;
+	a->vertex = 0;
+	a->numVertices = 0;
 	return a;
 }
 
 void ctArc_delete( ctArc * a, ctContext * ctx )
 {
-	(*(ctx->arcFree))(a,ctx->cbData);
+	ctMemory_sub( &ctx->mem, CT_MEM_ARCS, sizeof(ctArc) );
+	if (ctx->arcFree) (*(ctx->arcFree))(a,ctx->cbData);
+	else ctArena_free(a);
 }
 	
 ctArc * ctArc_find( ctArc * self )
@@ -0,0 +1,168 @@
+/*
+Copyright (c) 2006, Scott E. Dillard
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/* for posix_memalign */
+#define _POSIX_C_SOURCE 200112L
+
+#include "ctArena.h"
+#include "ctMisc.h"
+
+#include <stdio.h>
+
+
+typedef struct ctArena_Slab
+{
+    ctArena *arena;
+    struct ctArena_Slab *next;
+} ctArena_Slab;
+
+/* keep objects 16-byte aligned after the header */
+#define CT_ARENA_HEADER_SIZE ((sizeof(ctArena_Slab) + 15) & ~(size_t)15)
+
+
+void 
+ctArena_init( ctArena * self, size_t objectSize, void * owner )
+{
+    memset( self, 0, sizeof(ctArena) );
+    /* room for the free list link, and keep the alignment */
+    if ( objectSize < sizeof(void*) ) objectSize = sizeof(void*);
+    self->objectSize = (objectSize + 15) & ~(size_t)15;
+    self->owner = owner;
+    assert( self->objectSize <= CT_ARENA_SLAB_SIZE - CT_ARENA_HEADER_SIZE );
+}
+
+static
+void
+ctArena_freeSlabs( ctArena_Slab * s )
+{
+    while ( s ) {
+        ctArena_Slab *next = s->next;
+        free( s );
+        s = next;
+    }
+}
+
+void 
+ctArena_clear( ctArena * self )
+{
+    ctArena_freeSlabs( self->slabs );
+    ctArena_freeSlabs( self->spare );
+    ctArena_init( self, self->objectSize, self->owner );
+}
+
+void 
+ctArena_reset( ctArena * self )
+{
+    while ( self->slabs ) {
+        ctArena_Slab *s = self->slabs;
+        self->slabs = s->next;
+        s->next = self->spare;
+        self->spare = s;
+    }
+    self->bump = self->end = 0;
+    self->freeList = 0;
+    self->live = 0;
+}
+
+static
+void
+ctArena_newSlab( ctArena * self )
+{
+    void *mem = 0;
+    ctArena_Slab *s;
+    if ( self->spare ) {
+        mem = self->spare;
+        self->spare = self->spare->next;
+    } else if ( posix_memalign( &mem, CT_ARENA_SLAB_SIZE, CT_ARENA_SLAB_SIZE ) != 0 ) {
+        fprintf(stderr,"ctArena_newSlab: alloc returned null\n");
+        abort();
+    }
+    s = (ctArena_Slab*) mem;
+    s->arena = self;
+    s->next = self->slabs;
+    self->slabs = s;
+    self->bump = (char*)mem + CT_ARENA_HEADER_SIZE;
+    self->end = (char*)mem + CT_ARENA_SLAB_SIZE;
+}
+
+void* 
+ctArena_alloc( ctArena * self )
+{
+    void *p;
+    if ( self->freeList ) {
+        p = self->freeList;
+        self->freeList = *(void**)p;
+    } else {
+        if ( (size_t)(self->end - self->bump) < self->objectSize ) 
+            ctArena_newSlab( self );
+        p = self->bump;
+        self->bump += self->objectSize;
+    }
+    self->live++;
+    return p;
+}
+
+ctArena* 
+ctArena_of( void * object )
+{
+    size_t addr = (size_t)object;
+    return ((ctArena_Slab*)( addr & ~(CT_ARENA_SLAB_SIZE-1) ))->arena;
+}
+
+void 
+ctArena_free( void * object )
+{
+    ctArena *self = ctArena_of( object );
+    *(void**)object = self->freeList;
+    self->freeList = object;
+    self->live--;
+}
+
+
+ctTreeArena* 
+ctTreeArena_new( size_t arcSize, size_t nodeSize )
+{
+    ctTreeArena *self = (ctTreeArena*) malloc( sizeof(ctTreeArena) );
+    ctArena_init( &self->arcs, arcSize, self );
+    ctArena_init( &self->nodes, nodeSize, self );
+    return self;
+}
+
+void 
+ctTreeArena_delete( ctTreeArena * self )
+{
+    ctArena_clear( &self->arcs );
+    ctArena_clear( &self->nodes );
+    free( self );
+}
+
+void 
+ctTreeArena_reset( ctTreeArena * self )
+{
+    ctArena_reset( &self->arcs );
+    ctArena_reset( &self->nodes );
+}
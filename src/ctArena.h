@@ -0,0 +1,47 @@
+#ifndef CT_ARENA_H
+#define CT_ARENA_H
+
+#include <stdlib.h>
+
+/* 
+ * Fixed-size object allocator used by the default arc, node and branch
+ * allocators. Objects are carved out of 64KiB slabs, and are 16-byte
+ * aligned. Each slab is aligned to CT_ARENA_SLAB_SIZE, so that the slab (and
+ * from it the arena) of any object can be found by masking its address.
+ * Freed objects go on a free list; the slabs are only given back all at
+ * once, by ctArena_clear. 
+ */
+
+#define CT_ARENA_SLAB_SIZE ((size_t)1 << 16)
+
+struct ctArena_Slab;
+
+typedef struct ctArena
+{
+    size_t objectSize;
+    struct ctArena_Slab *slabs;
+    struct ctArena_Slab *spare; /* emptied by ctArena_reset, used first */
+    char *bump, *end; /* unused part of the newest slab */
+    void *freeList;
+    size_t live;      /* objects handed out and not freed */
+    void *owner;      /* whatever this arena is part of */
+} ctArena;
+
+/* The arcs and nodes of one contour tree. */
+typedef struct ctTreeArena
+{
+    ctArena arcs, nodes;
+} ctTreeArena;
+
+        void  ctArena_init   ( ctArena * self, size_t objectSize, void * owner );
+        void  ctArena_clear  ( ctArena * self ); /* free every slab */
+        void  ctArena_reset  ( ctArena * self ); /* free every object */
+       void*  ctArena_alloc  ( ctArena * self );
+        void  ctArena_free   ( void * object );
+    ctArena*  ctArena_of     ( void * object );
+
+ctTreeArena*  ctTreeArena_new    ( size_t arcSize, size_t nodeSize );
+        void  ctTreeArena_delete ( ctTreeArena * self );
+        void  ctTreeArena_reset  ( ctTreeArena * self );
+
+#endif
@@ -0,0 +1,222 @@
+/*
+Copyright (c) 2006, Scott E. Dillard
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "tourtre.h"
+#include "ctContext.h"
+#include "ctSort.h"
+#include "ctThread.h"
+#include "ctMisc.h"
+
+
+/* 
+ * ct_batch. Each worker starts with an even share of the jobs, as a range
+ * of indexes, and takes them from the front. A worker that runs out steals
+ * the back half of another worker's range. Ranges are only touched under
+ * their owner's lock, and no one holds two locks at once. 
+ */
+
+struct ctBatch;
+
+typedef struct ctBatch_Worker
+{
+    struct ctBatch *batch;
+    size_t id;
+    ctThread_Mutex *lock;
+    size_t next, end; /* jobs still to do */
+    ctContext *ctx;   /* reused for every job this worker runs */
+} ctBatch_Worker;
+
+typedef struct ctBatch
+{
+    ctJob *jobs;
+    size_t numWorkers;
+    ctBatch_Worker *workers;
+} ctBatch;
+
+
+/* Set up the worker's context for a job, making it the first time. */
+static
+ctContext *
+ctBatch_context( ctBatch_Worker * w, ctJob * job )
+{
+    ctContext *ctx = w->ctx;
+    size_t n = job->numVertices;
+
+    if ( !ctx ) ctx = w->ctx = ct_init( n, NULL, NULL, NULL, NULL );
+    else ct_recycle( ctx, n );
+
+    ctx->value = job->value;
+    ctx->neighbors = job->neighbors;
+    ctx->cbData = job->data;
+    ctx->priority = job->priority;
+    ctx->maxValence = job->maxValence ? job->maxValence : 256;
+
+    ctx->values = 0;
+    ctx->typedValues = 0;
+    if ( job->values && job->valueType == CT_VALUE_DOUBLE ) {
+        ctx->values = (double*) job->values;
+    } else if ( job->values ) {
+        ctx->typedValues = job->values;
+        ctx->valueType = job->valueType;
+    }
+
+    if ( job->neighbors ) {
+        ctx->domain = CT_DOMAIN_CALLBACK;
+    } else if ( job->csrOffsets ) {
+        ctx->domain = CT_DOMAIN_CSR;
+        ctx->csrOffsets = job->csrOffsets;
+        ctx->csrAdjacency = job->csrAdjacency;
+    } else {
+        ctx->domain = CT_DOMAIN_GRID;
+        ctGrid_init( &ctx->grid, job->dims, job->connectivity );
+    }
+
+    if ( job->totalOrder ) {
+        if ( ctx->totalOrderOwned ) free( ctx->totalOrder );
+        ctx->totalOrder = job->totalOrder;
+        ctx->totalOrderOwned = 0;
+    } else {
+        assert( job->values );
+        if ( !ctx->totalOrderOwned ) 
+            ctx->totalOrder = (ctIndex*) malloc( n * sizeof(ctIndex) );
+        ctx->totalOrderOwned = 1;
+        /* the batch already has a thread per core */
+        ctSort_vertices( job->values, job->valueType, n, ctx->totalOrder, 1 );
+    }
+
+    return ctx;
+}
+
+
+static
+void
+ctBatch_run( ctBatch_Worker * w, ctJob * job )
+{
+    ctContext *ctx = ctBatch_context( w, job );
+
+    ct_sweepAndMerge( ctx );
+    job->root = ct_decompose( ctx );
+    /* no budget or ct_outOfCore here, so this is malloc'd and the job
+     * can free() it, as ctJob promises */
+    job->branchMap = job->wantBranchMap ? ct_branchMap( ctx ) : NULL;
+}
+
+
+/* Move the back half of some other worker's jobs to w. */
+static
+int
+ctBatch_steal( ctBatch_Worker * w )
+{
+    ctBatch *b = w->batch;
+    size_t k;
+
+    for ( k = 1; k < b->numWorkers; k++ ) {
+        ctBatch_Worker *v = &b->workers[ (w->id + k) % b->numWorkers ];
+        size_t start, end;
+
+        ctThread_lock( v->lock );
+        end = v->end;
+        start = v->end -= (v->end - v->next + 1) / 2;
+        ctThread_unlock( v->lock );
+
+        if ( start < end ) {
+            ctThread_lock( w->lock );
+            w->next = start;
+            w->end = end;
+            ctThread_unlock( w->lock );
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+static
+void
+ctBatch_workerTask( void * arg )
+{
+    ctBatch_Worker *w = (ctBatch_Worker*) arg;
+
+    for (;;) {
+        size_t j = 0;
+        int found;
+
+        ctThread_lock( w->lock );
+        found = ( w->next < w->end );
+        if ( found ) j = w->next++;
+        ctThread_unlock( w->lock );
+
+        if ( found ) ctBatch_run( w, &w->batch->jobs[j] );
+        else if ( !ctBatch_steal( w ) ) break;
+    }
+}
+
+
+void 
+ct_batch( ctJob * jobs, size_t numJobs, size_t numThreads )
+{
+    ctBatch b;
+    ctThread_func *fn;
+    void **arg;
+    size_t k;
+
+    if ( numThreads == 0 ) numThreads = ctThread_numThreads();
+    if ( numThreads > numJobs ) numThreads = numJobs;
+    if ( numThreads == 0 ) return;
+
+    b.jobs = jobs;
+    b.numWorkers = numThreads;
+    b.workers = (ctBatch_Worker*) malloc( numThreads * sizeof(ctBatch_Worker) );
+    fn = (ctThread_func*) malloc( numThreads * sizeof(ctThread_func) );
+    arg = (void**) malloc( numThreads * sizeof(void*) );
+
+    for ( k = 0; k < numThreads; k++ ) {
+        ctBatch_Worker *w = &b.workers[k];
+        w->batch = &b;
+        w->id = k;
+        w->lock = ctThread_mutexNew();
+        w->next = numJobs*k/numThreads;
+        w->end = numJobs*(k+1)/numThreads;
+        w->ctx = NULL;
+        fn[k] = ctBatch_workerTask;
+        arg[k] = w;
+    }
+
+    ctThread_runAll( numThreads, fn, arg );
+
+    for ( k = 0; k < numThreads; k++ ) {
+        ctBatch_Worker *w = &b.workers[k];
+        if ( w->ctx ) {
+            ct_cleanup( w->ctx );
+            free( w->ctx );
+        }
+        ctThread_mutexDelete( w->lock );
+    }
+
+    free( arg );
+    free( fn );
+    free( b.workers );
+}
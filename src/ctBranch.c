@@ -29,25 +29,42 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "ctBranch.h"
 #include "ctContext.h"
 
-ctBranch * ctBranch_new( size_t e, size_t s, ctContext * ctx )
+ctBranch * ctBranch_new( ctIndex e, ctIndex s, ctContext * ctx )
 {
-    ctBranch * b = (*(ctx->branchAlloc))(ctx->cbData);
+    ctBranch * b;
+    if (ctx->branchAlloc) b = (*(ctx->branchAlloc))(ctx->cbData);
+    else b = (ctBranch*) ctArena_alloc( ct_branchArena(ctx) );
+    ctMemory_add( &ctx->mem, CT_MEM_BRANCHES, sizeof(ctBranch) );
     b->extremum = e;
     b->saddle = s;
+    b->saddleValue = ct_value(ctx,s);
+    b->extremumValue = ct_value(ctx,e);
     b->parent = NULL;
     b->children = ctBranchList_init();
     b->nextChild = b->prevChild = NULL;
     return b;
 }
 
-/* recursive delete */
+/* deletes the whole subtree, using a stack rather than recursion since
+ * branch decompositions can be very deep */
 void ctBranch_delete( ctBranch * self, ctContext * ctx )
 { 
-    ctBranch * c;
-    for ( c = self->children.head; c != NULL; c = c->nextChild ) {
-        ctBranch_delete( c, ctx );
+    size_t size = 1, cap = 256;
+    ctBranch ** stack = (ctBranch**) malloc( cap * sizeof(ctBranch*) );
+    stack[0] = self;
+    while ( size > 0 ) {
+        ctBranch * b = stack[--size];
+        ctBranch * c;
+        for ( c = b->children.head; c != NULL; c = c->nextChild ) {
+            if ( size == cap ) 
+                stack = (ctBranch**) realloc( stack, (cap*=2) * sizeof(ctBranch*) );
+            stack[size++] = c;
+        }
+        ctMemory_sub( &ctx->mem, CT_MEM_BRANCHES, sizeof(ctBranch) );
+        if (ctx->branchFree) (*(ctx->branchFree))(b,ctx->cbData);
+        else ctArena_free(b);
     }
-    (*(ctx->branchFree))(self,ctx->cbData);
+    free( stack );
 }
 
 ctBranchList ctBranchList_init()
@@ -57,10 +74,18 @@ ctBranchList ctBranchList_init()
 }
 
 
+/* the order of child lists, made total so that lists built by
+ * ctBranchList_add and by ctBranch_sortChildren agree */
+#define CT_BRANCH_LESS(A,B) \
+    ( (A)->saddleValue < (B)->saddleValue || \
+      ( (A)->saddleValue == (B)->saddleValue && \
+        ( (A)->saddle < (B)->saddle || \
+          ( (A)->saddle == (B)->saddle && (A)->extremum < (B)->extremum ) ) ) )
+
 static int 
-compareSaddles(size_t a, size_t b, ctContext * ctx)
+compareSaddles(ctBranch * a, ctBranch * b)
 {
-    return (*(ctx->value))(a,ctx->cbData) < (*(ctx->value))(b,ctx->cbData);
+    return CT_BRANCH_LESS(a,b);
 }
 
 void ctBranchList_add(ctBranchList * self, ctBranch * c, ctContext * ctx)
@@ -71,10 +96,12 @@ void ctBranchList_add(ctBranchList * self, ctBranch * c, ctContext * ctx)
         c->nextChild = NULL;
     } else {
         ctBranch * i = self->head;
-        while( compareSaddles(i->saddle,c->saddle,ctx) && i->nextChild ) 
+        while( compareSaddles(i,c) && i->nextChild ) {
             i = i->nextChild;
+            if ( ctx ) CT_STATS_ADD( ctx, branchListSteps, 1 );
+        }
         
-        if ( compareSaddles(i->saddle,c->saddle,ctx) ) { /* end of list */
+        if ( compareSaddles(i,c) ) { /* end of list */
             c->nextChild = NULL;
             c->prevChild = i;
             i->nextChild = c;
@@ -98,6 +125,80 @@ void ctBranchList_remove(ctBranchList * self, ctBranch * c)
 }
 
 
+void ctBranchList_push(ctBranchList * self, ctBranch * c)
+{
+    c->nextChild = self->head;
+    c->prevChild = self->head ? self->head->prevChild : c;
+    self->head = c;
+}
+
+
+void ctBranchList_append(ctBranchList * self, ctBranchList * other)
+{
+    ctBranch * tail;
+    if (!other->head) return;
+    if (!self->head) {
+        self->head = other->head;
+        return;
+    }
+    tail = self->head->prevChild;
+    tail->nextChild = other->head;
+    self->head->prevChild = other->head->prevChild;
+}
+
+
+/* merge sort of n branches linked by nextChild. Returns the new head; the
+ * last branch's nextChild is NULL. Comparisons are added to steps. */
+static ctBranch * sortBranches(ctBranch * head, size_t n, size_t * steps)
+{
+    ctBranch *a, *b, *mid, **link, *sorted = NULL;
+    size_t i;
+    if (n <= 1) {
+        if (head) head->nextChild = NULL;
+        return head;
+    }
+    mid = head;
+    for (i = 1; i < n/2; i++) mid = mid->nextChild;
+    b = mid->nextChild;
+    a = sortBranches(head, n/2, steps);
+    b = sortBranches(b, n - n/2, steps);
+
+    link = &sorted;
+    while (a && b) {
+        CT_STATS_COUNT( *steps );
+        if (CT_BRANCH_LESS(b,a)) { *link = b; b = b->nextChild; }
+        else { *link = a; a = a->nextChild; }
+        link = &((*link)->nextChild);
+    }
+    *link = a ? a : b;
+    return sorted;
+}
+
+
+void ctBranch_sortChildren( ctBranch * root, ctContext * ctx )
+{
+    size_t size = 1, cap = 256, steps = 0;
+    ctBranch ** stack = (ctBranch**) malloc( cap * sizeof(ctBranch*) );
+    stack[0] = root;
+    while ( size > 0 ) {
+        ctBranch * b = stack[--size];
+        ctBranch * c, * prev = NULL;
+        size_t n = 0;
+        for ( c = b->children.head; c != NULL; c = c->nextChild ) n++;
+        b->children.head = sortBranches( b->children.head, n, &steps );
+        for ( c = b->children.head; c != NULL; c = c->nextChild ) {
+            c->prevChild = prev;
+            prev = c;
+            if ( size == cap ) 
+                stack = (ctBranch**) realloc( stack, (cap*=2) * sizeof(ctBranch*) );
+            stack[size++] = c;
+        }
+    }
+    free( stack );
+    if ( ctx ) CT_STATS_ADD( ctx, branchListSteps, steps );
+}
+
+
 void ctBranchList_merge( ctBranchList * self, ctBranchList * other, ctContext * ctx )
 {
     if (!other->head) return;
@@ -112,7 +213,8 @@ void ctBranchList_merge( ctBranchList * self, ctBranchList * other, ctContext *
         ctBranch *o = other->head;
         ctBranch *li = 0, *lo = 0;
         while(i && o) {
-            if ( compareSaddles(o->saddle,i->saddle,ctx) ) {
+            if ( ctx ) CT_STATS_ADD( ctx, branchListSteps, 1 );
+            if ( compareSaddles(o,i) ) {
                 ctBranch * next;
                 lo = o;
                 /* move marker along */
@@ -30,105 +30,182 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <stdio.h>
 
-ctComponent * ctComponent_new( ctComponentType type )
+
+void ctComponentStore_init( ctComponentStore * self, ctComponentType type )
 {
-	ctComponent * c = (ctComponent*) malloc(sizeof(ctComponent));
-	c->birth = c->death = c->last = CT_NIL;
-	c->pred = c->succ = c->nextPred = c->prevPred = NULL;
-	c->uf = c;
-        c->type = type;
-	return c;
+	memset( self, 0, sizeof(ctComponentStore) );
+	self->type = type;
 }
 
-void ctComponent_delete( ctComponent * self ) 
+void ctComponentStore_clear( ctComponentStore * self )
 {
-	free(self);
+	int compact = self->compact;
+	free(self->birth);
+	free(self->death);
+	free(self->last);
+	free(self->pred);
+	free(self->succ);
+	free(self->nextPred);
+	free(self->prevPred);
+	free(self->uf);
+	free(self->live);
+	free(self->rank);
+	ctComponentStore_init( self, self->type );
+	self->compact = compact;
 }
-	
-void ctComponent_addPred(ctComponent * self, ctComponent * c)
+
+static void ctComponentStore_resize( ctComponentStore * self, size_t n )
+{
+	assert( n < CT_NIL && "too many components for ctIndex" );
+	self->birth    = (ctIndex*) realloc( self->birth, n * sizeof(ctIndex) );
+	self->death    = (ctIndex*) realloc( self->death, n * sizeof(ctIndex) );
+	self->last     = (ctIndex*) realloc( self->last, n * sizeof(ctIndex) );
+	self->pred     = (ctComponent*) realloc( self->pred, n * sizeof(ctComponent) );
+	self->succ     = (ctComponent*) realloc( self->succ, n * sizeof(ctComponent) );
+	self->nextPred = (ctComponent*) realloc( self->nextPred, n * sizeof(ctComponent) );
+	self->prevPred = (ctComponent*) realloc( self->prevPred, n * sizeof(ctComponent) );
+	self->uf       = (ctComponent*) realloc( self->uf, n * sizeof(ctComponent) );
+	self->live     = (ctComponent*) realloc( self->live, n * sizeof(ctComponent) );
+	self->rank     = (unsigned char*) realloc( self->rank, n );
+	if ( !self->birth || !self->death || !self->last || !self->pred || 
+	     !self->succ || !self->nextPred || !self->prevPred || !self->uf ||
+	     !self->live || !self->rank ) 
+	{
+		fprintf(stderr,"ctComponentStore_resize: alloc returned null\n");
+	}
+	self->capacity = n;
+}
+
+static void ctComponentStore_grow( ctComponentStore * self )
+{
+	size_t n;
+	if ( self->compact ) 
+		n = self->capacity ? self->capacity + self->capacity/4 + 1 : 256;
+	else 
+		n = self->capacity ? self->capacity * 2 : 1024;
+	ctComponentStore_resize( self, n );
+}
+
+void ctComponentStore_empty( ctComponentStore * self )
+{
+	self->size = 0;
+}
+
+void ctComponentStore_trim( ctComponentStore * self )
+{
+	if ( self->size > 0 && self->size < self->capacity ) 
+		ctComponentStore_resize( self, self->size );
+}
+
+size_t ctComponentStore_bytes( ctComponentStore * self )
 {
-	c->prevPred = NULL;
-	c->nextPred = self->pred;
-	if (self->pred) self->pred->prevPred = c;
-	self->pred = c;
+	return self->capacity * 
+		( 3*sizeof(ctIndex) + 6*sizeof(ctComponent) + sizeof(unsigned char) );
+}
+
+ctComponent ctComponent_new( ctComponentStore * self )
+{
+	ctComponent c;
+	if ( self->size == self->capacity ) ctComponentStore_grow( self );
+	c = self->size++;
+	self->birth[c] = self->death[c] = self->last[c] = CT_NIL;
+	self->pred[c] = self->succ[c] = self->nextPred[c] = self->prevPred[c] = CT_NIL;
+	self->uf[c] = self->live[c] = c;
+	self->rank[c] = 0;
+	return c;
+}
+
+void ctComponent_addPred( ctComponentStore * self, ctComponent c, ctComponent p )
+{
+	self->prevPred[p] = CT_NIL;
+	self->nextPred[p] = self->pred[c];
+	if (self->pred[c] != CT_NIL) self->prevPred[self->pred[c]] = p;
+	self->pred[c] = p;
 }
 	
-void ctComponent_removePred(ctComponent * self, ctComponent * c)
+void ctComponent_removePred( ctComponentStore * self, ctComponent c, ctComponent p )
 {
-	if (self->pred == c) self->pred = c->nextPred;
-	if (c->nextPred) c->nextPred->prevPred = c->prevPred;
-	if (c->prevPred) c->prevPred->nextPred = c->nextPred;
-	c->nextPred = c->prevPred = NULL;
+	if (self->pred[c] == p) self->pred[c] = self->nextPred[p];
+	if (self->nextPred[p] != CT_NIL) self->prevPred[self->nextPred[p]] = self->prevPred[p];
+	if (self->prevPred[p] != CT_NIL) self->nextPred[self->prevPred[p]] = self->nextPred[p];
+	self->nextPred[p] = self->prevPred[p] = CT_NIL;
 }
 
 
-/* merges this with successor. this becomes the new, merged component. successor is returned. */
-ctComponent * ctComponent_eatSuccessor( ctComponent * self )
+/* merges c with successor. c becomes the new, merged component. successor is returned. */
+ctComponent ctComponent_eatSuccessor( ctComponentStore * self, ctComponent c )
 {
-	assert( self->succ && self->succ->pred == self );
-	assert( self->nextPred == NULL );
+	assert( self->succ[c] != CT_NIL && self->pred[self->succ[c]] == c );
+	assert( self->nextPred[c] == CT_NIL );
 	
 	{
-		ctComponent * s = self->succ;
-		ctComponent * ss = s->succ;
-		if (ss) {
-			ctComponent_removePred(ss,s);
-			ctComponent_addPred(ss,self);
+		ctComponent s = self->succ[c];
+		ctComponent ss = self->succ[s];
+		if (ss != CT_NIL) {
+			ctComponent_removePred(self,ss,s);
+			ctComponent_addPred(self,ss,c);
 		}
-		self->death = s->death;
-		self->succ = s->succ;
-		s->succ = s->pred = NULL;
-		s->nextPred = s->prevPred = NULL;
-		ctComponent_union(self,self);
+		self->death[c] = self->death[s];
+		self->succ[c] = self->succ[s];
+		self->succ[s] = self->pred[s] = CT_NIL;
+		self->nextPred[s] = self->prevPred[s] = CT_NIL;
 		
 		return s;
 	}
 }
 	
-void ctComponent_prune( ctComponent * self )
+void ctComponent_prune( ctComponentStore * self, ctComponent c )
 {
-	assert(self->pred == NULL);
+	assert(self->pred[c] == CT_NIL);
 	{
-		if (self->succ) ctComponent_removePred(self->succ,self);
-		self->succ = NULL;
+		if (self->succ[c] != CT_NIL) ctComponent_removePred(self,self->succ[c],c);
+		self->succ[c] = CT_NIL;
 	}
 }
 
-int ctComponent_isLeaf( ctComponent * self )
+int ctComponent_isLeaf( ctComponentStore * self, ctComponent c )
 { 
-	return !self->pred; 
+	return self->pred[c] == CT_NIL; 
 }
 
-int ctComponent_isRegular( ctComponent * self )
+int ctComponent_isRegular( ctComponentStore * self, ctComponent c )
 { 
-	return self->pred && self->pred->nextPred == NULL; 
+	return self->pred[c] != CT_NIL && self->nextPred[self->pred[c]] == CT_NIL; 
 }
 
 
-ctComponent * ctComponent_find( ctComponent * self )
+static ctComponent ctComponent_root( ctComponentStore * self, ctComponent c )
 {
-	/* find parent */
-	ctComponent * c = self->uf;
-	while(c != c->uf) {
-		c = c->uf;
-	}
-	/* do path compression */
-	{
-		ctComponent *s = self->uf,*t;
-		while(s != c) { 
-			t = s->uf;
-			s->uf = c;
-			s = t;
-		}
-		self->uf = c;
+	ctComponent * uf = self->uf;
+	/* path halving */
+	while ( uf[c] != c ) {
+		uf[c] = uf[uf[c]];
+		c = uf[c];
+		CT_STATS_COUNT( self->findSteps );
 	}
 	return c;
 }
+
+ctComponent ctComponent_find( ctComponentStore * self, ctComponent c )
+{
+	CT_STATS_COUNT( self->finds );
+	return self->live[ ctComponent_root(self,c) ];
+}
 	
 	
-void ctComponent_union(ctComponent * a, ctComponent * b)
+void ctComponent_union( ctComponentStore * self, ctComponent a, ctComponent b )
 {
-	a->uf = b->uf; 
+	ctComponent ra = ctComponent_root(self,a);
+	ctComponent rb = ctComponent_root(self,b);
+	ctComponent live = self->live[rb];
+	if ( ra == rb ) return;
+
+	/* union by rank */
+	if ( self->rank[ra] > self->rank[rb] ) {
+		self->uf[rb] = ra;
+		self->live[ra] = live;
+	} else {
+		self->uf[ra] = rb;
+		if ( self->rank[ra] == self->rank[rb] ) self->rank[rb]++;
+	}
 }
-
-
@@ -29,6 +29,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define CT_COMPONENT_H
 
 #include "ctMisc.h"
+#include "ctStats.h"
 
 typedef 
 enum ctComponentType 
@@ -36,30 +37,59 @@ enum ctComponentType
     CT_JOIN_COMPONENT, CT_SPLIT_COMPONENT 
 } ctComponentType;
 
-typedef struct ctComponent
+/* 
+ * A component of the join or split tree. Components are indexes into a
+ * ctComponentStore, which keeps each field in its own array. CT_NIL means
+ * "no component". 
+ */
+typedef ctIndex ctComponent;
+
+typedef struct ctComponentStore
 {
-	size_t birth, death, last;
-	struct ctComponent *pred, *succ;
-	struct ctComponent *nextPred, *prevPred;
-	struct ctComponent *uf; /* union find */
-        ctComponentType type;
-	void * data; /* user data */
-} ctComponent;
-
-ctComponent*  ctComponent_new          ( ctComponentType type );
-        void  ctComponent_delete       ( ctComponent * self);
-        void  ctComponent_addPred      ( ctComponent * self, ctComponent * c );
-        void  ctComponent_removePred   ( ctComponent * self, ctComponent * c );
-
-ctComponent*  ctComponent_eatSuccessor ( ctComponent * self ); 
-                /* merges this with successor. this becomes the new, merged
-                 * component. successor is returned. */
+	ctComponentType type;
+	size_t size, capacity;
+	int compact; /* grow in small steps, see ct_memoryBudget */
+
+	ctIndex *birth, *death, *last;
+	ctComponent *pred, *succ;
+	ctComponent *nextPred, *prevPred;
 
-        void  ctComponent_prune        ( ctComponent * self );
-         int  ctComponent_isLeaf       ( ctComponent * self );
-         int  ctComponent_isRegular    ( ctComponent * self );
-ctComponent*  ctComponent_find         ( ctComponent * self );
-        void  ctComponent_union        ( ctComponent * a, ctComponent * b );
+	/* union-find. uf is the parent link. rank is only meaningful at a root,
+	 * as is live, which is the component that the whole set currently
+	 * belongs to. */
+	ctComponent *uf, *live;
+	unsigned char *rank;
 
+#ifdef CT_STATS
+	/* lookups and links followed, until ct_sweep moves them to ct_stats */
+	size_t finds, findSteps;
 #endif
+} ctComponentStore;
 
+        void  ctComponentStore_init    ( ctComponentStore * self, ctComponentType type );
+        void  ctComponentStore_clear   ( ctComponentStore * self );
+        void  ctComponentStore_empty   ( ctComponentStore * self );
+                /* remove every component, but keep the storage */
+        void  ctComponentStore_trim    ( ctComponentStore * self );
+                /* give back the storage beyond size */
+      size_t  ctComponentStore_bytes   ( ctComponentStore * self );
+
+ ctComponent  ctComponent_new          ( ctComponentStore * self );
+        void  ctComponent_addPred      ( ctComponentStore * self, ctComponent c, ctComponent p );
+        void  ctComponent_removePred   ( ctComponentStore * self, ctComponent c, ctComponent p );
+
+ ctComponent  ctComponent_eatSuccessor ( ctComponentStore * self, ctComponent c ); 
+                /* merges c with its successor. c becomes the new, merged
+                 * component. successor is returned. */
+
+        void  ctComponent_prune        ( ctComponentStore * self, ctComponent c );
+         int  ctComponent_isLeaf       ( ctComponentStore * self, ctComponent c );
+         int  ctComponent_isRegular    ( ctComponentStore * self, ctComponent c );
+
+ ctComponent  ctComponent_find         ( ctComponentStore * self, ctComponent c );
+                /* the live component of c's set */
+
+        void  ctComponent_union        ( ctComponentStore * self, ctComponent a, ctComponent b );
+                /* merge a's set into b's. b's live component survives */
+
+#endif
@@ -7,6 +7,21 @@
 #include "ctComponent.h"
 #include "ctQueue.h"
 #include "ctNodeMap.h"
+#include "ctGrid.h"
+#include "ctMemory.h"
+#include "ctArena.h"
+#include "ctSort.h"
+#include "ctStats.h"
+#include "ctPerf.h"
+
+
+/* Where the sweeps get the neighbors of a vertex from. */
+typedef enum ctDomain
+{
+    CT_DOMAIN_CALLBACK, /* ctContext.neighbors, set by ct_init */
+    CT_DOMAIN_CSR,      /* ctContext.csrOffsets/csrAdjacency, set by ct_initCSR */
+    CT_DOMAIN_GRID      /* ctContext.grid, set by ct_initGrid */
+} ctDomain;
 
 
 struct ctContext 
@@ -15,20 +30,58 @@ struct ctContext
      * NECESSARY -- Array of vertices, in ascending order. i \< j <==> less(
      * totalOrder[i], totalOrder[j] ) 
      **/
-    size_t * totalOrder;	
+    ctIndex * totalOrder;	
+    int totalOrderOwned; /* made by ct_initFromValues, so ours to free */
 
     /** 
      * NECESSARY -- Estimate of a vertex function value. ctContext.less takes
      * precedence. This is used only to estimate persistence for simplification 
      **/
-    double (*value)( size_t, void* );
+    double (*value)( ctIndex, void* );
 
     /** 
      * OPTIONAL -- Specify the neighbors of vertex v. This function should
      * store the neighbors in the array nbrs, which is of size CT_MAX_VALENCE.
      * This function should return the valence of vertex v 
      **/	    
-    size_t (*neighbors)( size_t v, size_t* nbrs, void* );
+    size_t (*neighbors)( ctIndex v, ctIndex* nbrs, void* );
+
+    /** 
+     * OPTIONAL -- Like ctContext.neighbors, but also told which worker is
+     * calling: 0 for the join sweep, 1 for the split sweep. Takes precedence
+     * over ctContext.neighbors. 
+     **/
+    size_t (*workerNeighbors)( ctIndex v, ctIndex* nbrs, size_t worker, void* );
+
+    /** 
+     * Which of the neighbor sources below is in use. 
+     **/
+    ctDomain domain;
+
+    /** 
+     * CSR adjacency, used instead of ctContext.neighbors when domain is
+     * CT_DOMAIN_CSR. The neighbors of v are csrAdjacency[csrOffsets[v]] up to
+     * (not including) csrAdjacency[csrOffsets[v+1]]. 
+     **/
+    size_t *csrOffsets;
+    ctIndex *csrAdjacency;
+
+    /** 
+     * Implicit grid connectivity, used when domain is CT_DOMAIN_GRID. 
+     **/
+    ctGrid grid;
+
+    /** 
+     * OPTIONAL -- Function value of every vertex. If this is set it is used
+     * instead of ctContext.value. Read it through ct_value. 
+     **/
+    double *values;
+
+    /** 
+     * OPTIONAL -- Like values, but of another type, from ct_initFromValues.
+     **/
+    const void *typedValues;
+    ctValueType valueType;
 
     /** 
      * OPTIONAL -- Maximum valence of a vertex. The default is 256. The array
@@ -47,7 +100,7 @@ struct ctContext
      * seed</a> for arc a.  It will be called many times for the "big,
      * important arcs."
      **/  
-    void (*procVertex)( size_t v, ctArc * a, void*);
+    void (*procVertex)( ctIndex v, ctArc * a, void*);
 
     /** 
      * OPTIONAL -- This is called when two arcs are merged by simplification.
@@ -66,6 +119,11 @@ struct ctContext
      **/	    
     double (*priority)( ctNode* , void* );
 
+    /* set by ct_simplifyThreshold: the merge cancels leaves whose priority
+     * is below simplifyThreshold */
+    int simplify;
+    double simplifyThreshold;
+
     /** 
      * OPTIONAL -- This is passed as the final argument to all callbacks. Use
      * this for reentrant code. 
@@ -73,6 +131,7 @@ struct ctContext
     void * cbData; /* last arg to all callbacks */
     
     
+    /* NULL means use the arenas below */
     ctArc* (*arcAlloc)(void*);
     void (*arcFree)(ctArc*,void*);
     
@@ -81,23 +140,72 @@ struct ctContext
     
     ctBranch* (*branchAlloc)(void*);
     void (*branchFree)(ctBranch*,void*);
+
+    /* where new arcs/nodes and branches go. Each tree gets an arena of its
+     * own, so it can be freed in one go; treeArena belongs to ctx->tree. */
+    ctTreeArena *treeArena;
+    ctArena *branchArena;
     
     
     /* 
      * Working memory used during the construction process. 
      */
     size_t numVerts;
-    ctComponent *joinRoot, *splitRoot;
-    ctComponent **joinComps, **splitComps;
-    size_t *nextJoin, *nextSplit;
+    ctComponentStore joinStore, splitStore;
+    ctComponent joinRoot, splitRoot;
+    ctComponent *joinComps, *splitComps;
+    ctIndex *nextJoin, *nextSplit; /* after joinComps and splitComps */
     ctArc ** arcMap;
     int arcMapOwned; /* does the library still own arcMap? */
     ctBranch ** branchMap; 
     int branchMapOwned; /* does the library still own branchMap */
     ctNodeMap *nodeMap;
 
+    /* set by ct_reset: keep the working memory from one run to the next,
+     * including these, which are otherwise made and freed by each run */
+    int reuse;
+    ctArc ** spareArcMap;
+    ctLeafQ *leafQ;
+    ctPriorityQ *priorityQ;
+
+    /* out-of-core mode: the directory for scratch files, or NULL. The flags
+     * say which arrays are mapped files, for ctScratch_free. */
+    char *scratchDir;
+    int joinMapped, splitMapped, arcMapMapped, branchMapMapped;
+
     ctArc *tree; 
+
+    /* what we hold, for ct_memoryStats; budget is set by ct_memoryBudget */
+    ctMemory mem;
+
+#ifdef CT_STATS
+    /* for ct_stats, and when each running timer started; with
+     * ct_hardwareCounters on, each phase also has its counters, and notes
+     * which of them counted anything, for stats.eventCounted */
+    ctStats stats;
+    double statsStart[CT_STATS_NUM_STARTS];
+    int statsEvents;
+    ctPerf statsPerf[CT_NUM_PHASES];
+    int statsCounted[CT_NUM_PHASES][CT_NUM_EVENTS];
+#endif
 };
 
+
+/* Drop the last run, but keep its memory for another one on numVerts
+ * vertices. See ct_reset. */
+void ct_recycle( ctContext * ctx, size_t numVerts );
+
+
+/* The current arenas, created when first needed. */
+ctTreeArena* ct_treeArena( ctContext * ctx );
+ctArena* ct_branchArena( ctContext * ctx );
+
+
+/* Function value of vertex v, without a callback if we have the array. */
+#define ct_value(ctx,v) \
+    ((ctx)->values ? (ctx)->values[v] : \
+     (ctx)->typedValues ? ctSort_value((ctx)->typedValues,(ctx)->valueType,(v)) : \
+     (*((ctx)->value))((v),(ctx)->cbData))
+
  
 #endif
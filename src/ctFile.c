@@ -0,0 +1,345 @@
+/*
+Copyright (c) 2006, Scott E. Dillard
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+#define _XOPEN_SOURCE 600
+
+#include "tourtre.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/* sections start on cache lines, as the arrays of frozen trees do */
+#define CT_FILE_ALIGN 64
+#define CT_FILE_ROUND(n) ( ((n) + CT_FILE_ALIGN-1) & ~(size_t)(CT_FILE_ALIGN-1) )
+
+#define CT_FILE_VERSION 1
+#define CT_FILE_ORDER ((size_t)0x01020304)
+
+#define CT_FILE_TREE 1
+#define CT_FILE_BRANCHES 2
+
+enum {
+    CT_FILE_NODE_VERTEX,
+    CT_FILE_NODE_VALUE,
+    CT_FILE_UP_START,
+    CT_FILE_DOWN_START,
+    CT_FILE_DOWN_ARCS,
+    CT_FILE_ARC_HI,
+    CT_FILE_ARC_LO,
+    CT_FILE_ARC_MAP,
+    CT_FILE_EXTREMUM,
+    CT_FILE_SADDLE,
+    CT_FILE_EXTREMUM_VALUE,
+    CT_FILE_SADDLE_VALUE,
+    CT_FILE_PERSISTENCE,
+    CT_FILE_PARENT,
+    CT_FILE_CHILD_START,
+    CT_FILE_BRANCH_MAP,
+    CT_FILE_SECTIONS
+};
+
+typedef struct ctFileSection
+{
+    size_t offset;
+    size_t bytes;
+} ctFileSection;
+
+typedef struct ctFileHeader
+{
+    char magic[8];
+    unsigned char version;
+    unsigned char indexBytes;
+    unsigned char sizeBytes;
+    unsigned char doubleBytes;
+    size_t order;
+    size_t fileBytes;
+    size_t contents;
+
+    size_t numNodes;
+    size_t numArcs;
+    size_t treeVerts;
+    size_t numBranches;
+    size_t branchVerts;
+
+    ctFileSection sections[CT_FILE_SECTIONS];
+} ctFileHeader;
+
+static const char ctFile_magic[8] = "tourtre";
+
+/* what ct_mapFile hands out, and what it has to give back */
+typedef struct ctFile_Mapping
+{
+    ctMappedFile file;
+    ctFrozenTree tree;
+    ctFrozenBranches branches;
+    void *map;
+    size_t bytes;
+} ctFile_Mapping;
+
+
+/* Number of elements of section k, and their size. */
+static
+size_t
+ctFile_count( const ctFileHeader *h, int k, size_t *elem )
+{
+    int tree = (h->contents & CT_FILE_TREE) != 0;
+    int branches = (h->contents & CT_FILE_BRANCHES) != 0;
+
+    *elem = sizeof(ctIndex);
+    switch ( k ) {
+        case CT_FILE_NODE_VALUE : *elem = sizeof(double); /* fall through */
+        case CT_FILE_NODE_VERTEX : return tree ? h->numNodes : 0;
+        case CT_FILE_UP_START :
+        case CT_FILE_DOWN_START : return tree ? h->numNodes+1 : 0;
+        case CT_FILE_DOWN_ARCS :
+        case CT_FILE_ARC_HI :
+        case CT_FILE_ARC_LO : return tree ? h->numArcs : 0;
+        case CT_FILE_ARC_MAP : return tree ? h->treeVerts : 0;
+        case CT_FILE_EXTREMUM_VALUE :
+        case CT_FILE_SADDLE_VALUE :
+        case CT_FILE_PERSISTENCE : *elem = sizeof(double); /* fall through */
+        case CT_FILE_EXTREMUM :
+        case CT_FILE_SADDLE :
+        case CT_FILE_PARENT : return branches ? h->numBranches : 0;
+        case CT_FILE_CHILD_START : return branches ? h->numBranches+1 : 0;
+        case CT_FILE_BRANCH_MAP : return branches ? h->branchVerts : 0;
+    }
+    return 0;
+}
+
+
+/* Fill in the section table from the counts, and return the file size. */
+static
+size_t
+ctFile_layout( ctFileHeader *h )
+{
+    size_t off = CT_FILE_ROUND( sizeof(ctFileHeader) );
+    int k;
+    for ( k = 0; k < CT_FILE_SECTIONS; k++ ) {
+        size_t elem, count = ctFile_count( h, k, &elem );
+        h->sections[k].offset = off;
+        h->sections[k].bytes = count * elem;
+        off += CT_FILE_ROUND( count * elem );
+    }
+    return off;
+}
+
+
+int
+ct_save( const char * path, const ctFrozenTree * tree, const ctFrozenBranches * branches )
+{
+    static const char zeros[CT_FILE_ALIGN] = { 0 };
+    const void *src[CT_FILE_SECTIONS];
+    ctFileHeader h;
+    FILE *out;
+    size_t pad;
+    int k, ok;
+
+    memset( &h, 0, sizeof(h) );
+    memset( (void*)src, 0, sizeof(src) );
+    memcpy( h.magic, ctFile_magic, sizeof(h.magic) );
+    h.version = CT_FILE_VERSION;
+    h.indexBytes = sizeof(ctIndex);
+    h.sizeBytes = sizeof(size_t);
+    h.doubleBytes = sizeof(double);
+    h.order = CT_FILE_ORDER;
+
+    if ( tree ) {
+        h.contents |= CT_FILE_TREE;
+        h.numNodes = tree->numNodes;
+        h.numArcs = tree->numArcs;
+        h.treeVerts = tree->numVerts;
+        src[CT_FILE_NODE_VERTEX] = tree->nodeVertex;
+        src[CT_FILE_NODE_VALUE] = tree->nodeValue;
+        src[CT_FILE_UP_START] = tree->upStart;
+        src[CT_FILE_DOWN_START] = tree->downStart;
+        src[CT_FILE_DOWN_ARCS] = tree->downArcs;
+        src[CT_FILE_ARC_HI] = tree->arcHi;
+        src[CT_FILE_ARC_LO] = tree->arcLo;
+        src[CT_FILE_ARC_MAP] = tree->arcMap;
+    }
+    if ( branches ) {
+        h.contents |= CT_FILE_BRANCHES;
+        h.numBranches = branches->numBranches;
+        h.branchVerts = branches->numVerts;
+        src[CT_FILE_EXTREMUM] = branches->extremum;
+        src[CT_FILE_SADDLE] = branches->saddle;
+        src[CT_FILE_EXTREMUM_VALUE] = branches->extremumValue;
+        src[CT_FILE_SADDLE_VALUE] = branches->saddleValue;
+        src[CT_FILE_PERSISTENCE] = branches->persistence;
+        src[CT_FILE_PARENT] = branches->parent;
+        src[CT_FILE_CHILD_START] = branches->childStart;
+        src[CT_FILE_BRANCH_MAP] = branches->branchMap;
+    }
+    h.fileBytes = ctFile_layout( &h );
+
+    out = fopen( path, "wb" );
+    if ( !out ) {
+        fprintf(stderr,"ct_save : can't open %s for writing\n", path);
+        return 0;
+    }
+
+    pad = CT_FILE_ROUND( sizeof(h) ) - sizeof(h);
+    ok = fwrite( &h, sizeof(h), 1, out ) == 1 && fwrite( zeros, 1, pad, out ) == pad;
+    for ( k = 0; ok && k < CT_FILE_SECTIONS; k++ ) {
+        size_t bytes = h.sections[k].bytes;
+        pad = CT_FILE_ROUND( bytes ) - bytes;
+        ok = fwrite( src[k], 1, bytes, out ) == bytes && fwrite( zeros, 1, pad, out ) == pad;
+    }
+    if ( fclose( out ) != 0 ) ok = 0;
+
+    if ( !ok ) {
+        fprintf(stderr,"ct_save : error writing %s\n", path);
+        remove( path );
+    }
+    return ok;
+}
+
+
+/* Check the header h of a file of the given size. Returns why it's no good,
+ * or NULL. */
+static
+const char *
+ctFile_check( const ctFileHeader *h, size_t size )
+{
+    ctFileHeader expect;
+    int k;
+
+    if ( size < sizeof(ctFileHeader) || memcmp( h->magic, ctFile_magic, sizeof(h->magic) ) != 0 )
+        return "not a tourtre file";
+    if ( h->version != CT_FILE_VERSION ) 
+        return "unknown version";
+    if ( h->indexBytes != sizeof(ctIndex) || h->sizeBytes != sizeof(size_t) || 
+         h->doubleBytes != sizeof(double) || h->order != CT_FILE_ORDER ) 
+        return "written on an incompatible machine";
+    if ( h->fileBytes != size || (h->contents & ~(size_t)(CT_FILE_TREE|CT_FILE_BRANCHES)) ) 
+        return "corrupt header";
+
+    /* no count can be more than the file holds, so the layout can't overflow */
+    for ( k = 0; k < CT_FILE_SECTIONS; k++ ) {
+        size_t elem, count = ctFile_count( h, k, &elem );
+        if ( count > size / elem ) return "corrupt header";
+    }
+    expect = *h;
+    if ( ctFile_layout( &expect ) != size || 
+         memcmp( expect.sections, h->sections, sizeof(h->sections) ) != 0 ) 
+        return "corrupt header";
+    return NULL;
+}
+
+
+ctMappedFile*
+ct_mapFile( const char * path )
+{
+    ctFile_Mapping *m;
+    const ctFileHeader *h;
+    const char *why;
+    struct stat s;
+    char *base;
+    void *map;
+    int fd;
+
+    fd = open( path, O_RDONLY );
+    if ( fd < 0 ) {
+        fprintf(stderr,"ct_mapFile : can't open %s\n", path);
+        return NULL;
+    }
+    if ( fstat( fd, &s ) != 0 || (size_t)s.st_size < sizeof(ctFileHeader) ) {
+        close( fd );
+        fprintf(stderr,"ct_mapFile : %s : not a tourtre file\n", path);
+        return NULL;
+    }
+    map = mmap( NULL, s.st_size, PROT_READ, MAP_SHARED, fd, 0 );
+    close( fd );
+    if ( map == MAP_FAILED ) {
+        fprintf(stderr,"ct_mapFile : can't map %s\n", path);
+        return NULL;
+    }
+
+    h = (const ctFileHeader*) map;
+    why = ctFile_check( h, s.st_size );
+    if ( why ) {
+        munmap( map, s.st_size );
+        fprintf(stderr,"ct_mapFile : %s : %s\n", path, why);
+        return NULL;
+    }
+
+    m = (ctFile_Mapping*) calloc( 1, sizeof(ctFile_Mapping) );
+    m->map = map;
+    m->bytes = s.st_size;
+    base = (char*) map;
+
+#define CT_FILE_ARRAY(obj,field,type,k) \
+    obj.field = h->sections[k].bytes ? (type*) (base + h->sections[k].offset) : NULL;
+
+    if ( h->contents & CT_FILE_TREE ) {
+        m->tree.numNodes = h->numNodes;
+        m->tree.numArcs = h->numArcs;
+        m->tree.numVerts = h->treeVerts;
+        CT_FILE_ARRAY( m->tree, nodeVertex, ctIndex, CT_FILE_NODE_VERTEX )
+        CT_FILE_ARRAY( m->tree, nodeValue, double, CT_FILE_NODE_VALUE )
+        CT_FILE_ARRAY( m->tree, upStart, ctIndex, CT_FILE_UP_START )
+        CT_FILE_ARRAY( m->tree, downStart, ctIndex, CT_FILE_DOWN_START )
+        CT_FILE_ARRAY( m->tree, downArcs, ctIndex, CT_FILE_DOWN_ARCS )
+        CT_FILE_ARRAY( m->tree, arcHi, ctIndex, CT_FILE_ARC_HI )
+        CT_FILE_ARRAY( m->tree, arcLo, ctIndex, CT_FILE_ARC_LO )
+        CT_FILE_ARRAY( m->tree, arcMap, ctIndex, CT_FILE_ARC_MAP )
+        m->file.tree = &m->tree;
+    }
+    if ( h->contents & CT_FILE_BRANCHES ) {
+        m->branches.numBranches = h->numBranches;
+        m->branches.numVerts = h->branchVerts;
+        CT_FILE_ARRAY( m->branches, extremum, ctIndex, CT_FILE_EXTREMUM )
+        CT_FILE_ARRAY( m->branches, saddle, ctIndex, CT_FILE_SADDLE )
+        CT_FILE_ARRAY( m->branches, extremumValue, double, CT_FILE_EXTREMUM_VALUE )
+        CT_FILE_ARRAY( m->branches, saddleValue, double, CT_FILE_SADDLE_VALUE )
+        CT_FILE_ARRAY( m->branches, persistence, double, CT_FILE_PERSISTENCE )
+        CT_FILE_ARRAY( m->branches, parent, ctIndex, CT_FILE_PARENT )
+        CT_FILE_ARRAY( m->branches, childStart, ctIndex, CT_FILE_CHILD_START )
+        CT_FILE_ARRAY( m->branches, branchMap, ctIndex, CT_FILE_BRANCH_MAP )
+        m->file.branches = &m->branches;
+    }
+
+#undef CT_FILE_ARRAY
+    return &m->file;
+}
+
+
+void
+ct_unmapFile( ctMappedFile * file )
+{
+    ctFile_Mapping *m = (ctFile_Mapping*) file;
+    if ( !m ) return;
+    munmap( m->map, m->bytes );
+    free( m );
+}
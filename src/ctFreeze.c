@@ -0,0 +1,242 @@
+/*
+Copyright (c) 2006, Scott E. Dillard
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "tourtre.h"
+#include "ctContext.h"
+#include "ctMisc.h"
+
+#include <math.h>
+
+
+/* the arrays of a frozen tree start on cache lines */
+#define CT_FROZEN_ALIGN 64
+#define CT_FROZEN_ROUND(n) ( ((n) + CT_FROZEN_ALIGN-1) & ~(size_t)(CT_FROZEN_ALIGN-1) )
+
+
+/* Lay the arrays out after the struct, in one block. Returns its size, and
+ * if block isn't NULL, points the arrays into it. */
+static
+size_t
+ctFrozen_layout( ctFrozenTree *t, char *block )
+{
+    size_t off = CT_FROZEN_ROUND( sizeof(ctFrozenTree) );
+
+#define CT_FROZEN_ARRAY(field,type,count) \
+    if ( block ) t->field = (type*) (block + off); \
+    off += CT_FROZEN_ROUND( (count) * sizeof(type) );
+
+    CT_FROZEN_ARRAY( nodeVertex, ctIndex, t->numNodes )
+    CT_FROZEN_ARRAY( nodeValue, double, t->numNodes )
+    CT_FROZEN_ARRAY( nodeData, void*, t->numNodes )
+    CT_FROZEN_ARRAY( upStart, ctIndex, t->numNodes+1 )
+    CT_FROZEN_ARRAY( downStart, ctIndex, t->numNodes+1 )
+    CT_FROZEN_ARRAY( downArcs, ctIndex, t->numArcs )
+    CT_FROZEN_ARRAY( arcHi, ctIndex, t->numArcs )
+    CT_FROZEN_ARRAY( arcLo, ctIndex, t->numArcs )
+    CT_FROZEN_ARRAY( arcData, void*, t->numArcs )
+    CT_FROZEN_ARRAY( arcMap, ctIndex, t->numVerts )
+
+#undef CT_FROZEN_ARRAY
+    return off;
+}
+
+
+/* Id of arc a, which goes up from node lo. */
+static
+ctIndex
+ctFrozen_arcId( ctFrozenTree *t, ctArc *a )
+{
+    ctIndex id = t->upStart[ a->lo->heapPos ];
+    ctArc *b;
+    for ( b = a->lo->up; b != a; b = b->nextUp ) id++;
+    return id;
+}
+
+
+ctFrozenTree*
+ct_freezeTree( ctContext * ctx, ctArc * a, ctArc ** arcMap )
+{
+    ctFrozenTree head, *t;
+    ctArc **arcs;
+    ctNode **nodes;
+    size_t numArcs, numNodes, n, i;
+    char *block;
+
+    ct_arcsAndNodes( a, &arcs, &numArcs, &nodes, &numNodes );
+
+    head.numNodes = numNodes;
+    head.numArcs = numArcs;
+    head.numVerts = arcMap ? ctx->numVerts : 0;
+    block = (char*) malloc( ctFrozen_layout( &head, NULL ) );
+    t = (ctFrozenTree*) block;
+    *t = head;
+    ctFrozen_layout( t, block );
+
+    /* the nodes are numbered in the order ct_arcsAndNodes found them. The
+     * number goes in heapPos, which is free outside of ct_decompose, until
+     * the arcs are done */
+    t->upStart[0] = 0;
+    for ( n = 0; n < numNodes; n++ ) {
+        ctNode *node = nodes[n];
+        ctArc *b;
+        ctIndex degree = 0;
+        node->heapPos = n;
+        t->nodeVertex[n] = node->i;
+        t->nodeValue[n] = node->value;
+        t->nodeData[n] = node->data;
+        for ( b = node->up; b; b = b->nextUp ) degree++;
+        t->upStart[n+1] = t->upStart[n] + degree;
+    }
+
+    /* arcs by lo node; count the down arcs of each node as we go */
+    memset( t->downStart, 0, (numNodes+1) * sizeof(ctIndex) );
+    for ( n = 0; n < numNodes; n++ ) {
+        ctArc *b;
+        ctIndex id = t->upStart[n];
+        for ( b = nodes[n]->up; b; b = b->nextUp, id++ ) {
+            t->arcHi[id] = b->hi->heapPos;
+            t->arcLo[id] = n;
+            t->arcData[id] = b->data;
+            t->downStart[ b->hi->heapPos + 1 ]++;
+        }
+    }
+    for ( n = 0; n < numNodes; n++ ) t->downStart[n+1] += t->downStart[n];
+
+    {   /* place each arc at its hi node's next free slot */
+        ctIndex *next = (ctIndex*) malloc( (numNodes+1) * sizeof(ctIndex) );
+        memcpy( next, t->downStart, (numNodes+1) * sizeof(ctIndex) );
+        for ( i = 0; i < numArcs; i++ ) t->downArcs[ next[t->arcHi[i]]++ ] = i;
+        free( next );
+    }
+
+    for ( i = 0; i < t->numVerts; i++ ) 
+        t->arcMap[i] = ctFrozen_arcId( t, ctArc_find( arcMap[i] ) );
+
+    for ( n = 0; n < numNodes; n++ ) nodes[n]->heapPos = CT_NIL;
+    free( arcs );
+    free( nodes );
+    return t;
+}
+
+
+void
+ct_deleteFrozenTree( ctFrozenTree * tree )
+{
+    free( tree );
+}
+
+
+static
+size_t
+ctFrozen_branchLayout( ctFrozenBranches *t, char *block )
+{
+    size_t off = CT_FROZEN_ROUND( sizeof(ctFrozenBranches) );
+
+#define CT_FROZEN_ARRAY(field,type,count) \
+    if ( block ) t->field = (type*) (block + off); \
+    off += CT_FROZEN_ROUND( (count) * sizeof(type) );
+
+    CT_FROZEN_ARRAY( extremum, ctIndex, t->numBranches )
+    CT_FROZEN_ARRAY( saddle, ctIndex, t->numBranches )
+    CT_FROZEN_ARRAY( extremumValue, double, t->numBranches )
+    CT_FROZEN_ARRAY( saddleValue, double, t->numBranches )
+    CT_FROZEN_ARRAY( persistence, double, t->numBranches )
+    CT_FROZEN_ARRAY( parent, ctIndex, t->numBranches )
+    CT_FROZEN_ARRAY( childStart, ctIndex, t->numBranches+1 )
+    CT_FROZEN_ARRAY( data, void*, t->numBranches )
+    CT_FROZEN_ARRAY( branchMap, ctIndex, t->numVerts )
+
+#undef CT_FROZEN_ARRAY
+    return off;
+}
+
+
+ctFrozenBranches*
+ct_freezeBranches( ctBranch * root, ctBranch ** branchMap, size_t numVerts )
+{
+    ctFrozenBranches head, *t;
+    ctBranch **order, *c;
+    size_t numBranches, storage, next, b, i;
+    char *block;
+
+    /* number the branches breadth first, so that the children of each
+     * branch have consecutive ids */
+    numBranches = 1;
+    storage = 64;
+    order = (ctBranch**) malloc( storage * sizeof(ctBranch*) );
+    order[0] = root;
+    for ( b = 0; b < numBranches; b++ ) {
+        for ( c = order[b]->children.head; c; c = c->nextChild ) {
+            if ( numBranches == storage ) {
+                storage *= 2;
+                order = (ctBranch**) realloc( order, storage * sizeof(ctBranch*) );
+            }
+            order[numBranches++] = c;
+        }
+    }
+
+    head.numBranches = numBranches;
+    head.numVerts = branchMap ? numVerts : 0;
+    block = (char*) malloc( ctFrozen_branchLayout( &head, NULL ) );
+    t = (ctFrozenBranches*) block;
+    *t = head;
+    ctFrozen_branchLayout( t, block );
+
+    next = 1;
+    for ( b = 0; b < numBranches; b++ ) {
+        ctBranch *br = order[b];
+        t->extremum[b] = br->extremum;
+        t->saddle[b] = br->saddle;
+        t->extremumValue[b] = br->extremumValue;
+        t->saddleValue[b] = br->saddleValue;
+        t->persistence[b] = fabs( br->extremumValue - br->saddleValue );
+        t->data[b] = br->data;
+        t->childStart[b] = next;
+        for ( c = br->children.head; c; c = c->nextChild ) t->parent[next++] = b;
+    }
+    t->childStart[numBranches] = next;
+    t->parent[0] = CT_NIL;
+
+    /* while the map is done, each branch's data points at its slot in
+     * order, which gives its id */
+    if ( t->numVerts ) {
+        for ( b = 0; b < numBranches; b++ ) order[b]->data = &order[b];
+        for ( i = 0; i < t->numVerts; i++ ) 
+            t->branchMap[i] = (ctBranch**) branchMap[i]->data - order;
+        for ( b = 0; b < numBranches; b++ ) order[b]->data = t->data[b];
+    }
+
+    free( order );
+    return t;
+}
+
+
+void
+ct_deleteFrozenBranches( ctFrozenBranches * branches )
+{
+    free( branches );
+}
@@ -0,0 +1,113 @@
+/*
+Copyright (c) 2006, Scott E. Dillard
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "tourtre.h"
+#include "ctGrid.h"
+#include "ctMisc.h"
+
+
+static void
+ctGrid_addOffset( ctGrid * self, int dx, int dy, int dz )
+{
+    size_t k = self->numOffsets++;
+    long off = dx + (long)self->dims[0] * ( dy + (long)self->dims[1] * dz );
+    self->dx[k] = dx;
+    self->dy[k] = dy;
+    self->dz[k] = dz;
+    self->offset[k] = (ctIndex) off; /* wraps for negative offsets */
+}
+
+
+void 
+ctGrid_init( ctGrid * self, size_t dims[3], ctGridConnectivity connectivity )
+{
+    int dx,dy,dz;
+    size_t a;
+
+    self->dims[0] = dims[0];
+    self->dims[1] = dims[1];
+    self->dims[2] = dims[2];
+    self->numOffsets = 0;
+
+    switch (connectivity) {
+    case CT_GRID_4 :
+    case CT_GRID_8 :
+        assert( dims[2] == 1 && "4- and 8-connectivity are for 2D grids" );
+        for (dy = -1; dy <= 1; dy++) 
+        for (dx = -1; dx <= 1; dx++) {
+            int m = abs(dx) + abs(dy);
+            if ( m == 0 ) continue;
+            if ( m == 2 && connectivity == CT_GRID_4 ) continue;
+            ctGrid_addOffset(self,dx,dy,0);
+        }
+        break;
+
+    case CT_GRID_6 :
+    case CT_GRID_18 :
+    case CT_GRID_26 :
+        for (dz = -1; dz <= 1; dz++) 
+        for (dy = -1; dy <= 1; dy++) 
+        for (dx = -1; dx <= 1; dx++) {
+            int m = abs(dx) + abs(dy) + abs(dz);
+            if ( m == 0 ) continue;
+            if ( m == 2 && connectivity == CT_GRID_6 ) continue;
+            if ( m == 3 && connectivity != CT_GRID_26 ) continue;
+            ctGrid_addOffset(self,dx,dy,dz);
+        }
+        break;
+
+    case CT_GRID_FREUDENTHAL :
+        /* The Freudenthal (Kuhn) triangulation splits each cell along the
+         * (+,+,+) diagonal. A vertex is joined to the cube corners whose
+         * offset has all components of one sign. */
+        for (dz = -1; dz <= 1; dz++) 
+        for (dy = -1; dy <= 1; dy++) 
+        for (dx = -1; dx <= 1; dx++) {
+            int pos = dx > 0 || dy > 0 || dz > 0;
+            int neg = dx < 0 || dy < 0 || dz < 0;
+            if ( !pos && !neg ) continue;
+            if ( pos && neg ) continue;
+            if ( dims[2] == 1 && dz != 0 ) continue;
+            ctGrid_addOffset(self,dx,dy,dz);
+        }
+        break;
+
+    default :
+        assert( FALSE && "unknown grid connectivity" );
+    }
+
+    for ( a = 0; a < 3; a++ ) {
+        size_t k;
+        int used = 0;
+        for ( k = 0; k < self->numOffsets; k++ ) {
+            int d = a == 0 ? self->dx[k] : a == 1 ? self->dy[k] : self->dz[k];
+            if (d) used = 1;
+        }
+        self->lo[a] = used ? 1 : 0;
+        self->hi[a] = used ? dims[a]-1 : dims[a];
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef CT_GRID_H
+#define CT_GRID_H
+
+#include <stdlib.h>
+#include "tourtre.h"
+
+/* 
+ * Implicit connectivity of a regular grid, for ct_initGrid. Vertex (x,y,z)
+ * has index x + dims[0]*(y + dims[1]*z). 
+ */
+typedef struct ctGrid
+{
+    size_t dims[3];
+
+    /* neighbor stencil */
+    size_t numOffsets;
+    int dx[26], dy[26], dz[26];
+
+    /* the stencil as index offsets, stored modulo 2^n so that v+offset[k]
+     * wraps around to the right answer */
+    ctIndex offset[26];
+
+    /* a vertex is interior, meaning no stencil point leaves the grid, iff
+     * lo[a] <= coord[a] < hi[a] on every axis */
+    size_t lo[3], hi[3];
+
+} ctGrid;
+
+void ctGrid_init( ctGrid * self, size_t dims[3], ctGridConnectivity connectivity );
+
+#endif
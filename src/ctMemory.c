@@ -0,0 +1,56 @@
+/*
+Copyright (c) 2006, Scott E. Dillard
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "ctMemory.h"
+#include "ctMisc.h"
+
+
+void 
+ctMemory_add( ctMemory * self, ctMemCategory c, size_t bytes )
+{
+    self->current[c] += bytes;
+    self->total += bytes;
+    if ( self->current[c] > self->peak[c] ) self->peak[c] = self->current[c];
+    if ( self->total > self->totalPeak ) self->totalPeak = self->total;
+}
+
+void 
+ctMemory_sub( ctMemory * self, ctMemCategory c, size_t bytes )
+{
+    assert( self->current[c] >= bytes );
+    self->current[c] -= bytes;
+    self->total -= bytes;
+}
+
+void 
+ctMemory_set( ctMemory * self, ctMemCategory c, size_t bytes )
+{
+    if ( bytes > self->current[c] ) 
+        ctMemory_add( self, c, bytes - self->current[c] );
+    else 
+        ctMemory_sub( self, c, self->current[c] - bytes );
+}
@@ -0,0 +1,19 @@
+#ifndef CT_MEMORY_H
+#define CT_MEMORY_H
+
+#include <stdlib.h>
+#include "tourtre.h"
+
+/* 
+ * Memory accounting for ct_memoryStats. Categories that change one object
+ * at a time use add/sub; the rest are sampled with set at the points where
+ * they are largest. None of this is thread safe, so it is only called from
+ * the serial parts of the algorithm. 
+ */
+typedef ctMemoryStats ctMemory;
+
+void ctMemory_add( ctMemory * self, ctMemCategory c, size_t bytes );
+void ctMemory_sub( ctMemory * self, ctMemCategory c, size_t bytes );
+void ctMemory_set( ctMemory * self, ctMemCategory c, size_t bytes );
+
+#endif
@@ -33,7 +33,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <assert.h>
 #include <string.h>
 
-#define CT_NIL 0xffffffff
+#include "ctIndex.h"
+
+/* all bits set, so that memset(a,0xff,n) fills an index array with it */
+#define CT_NIL ((ctIndex)-1)
 
 
 #ifndef TRUE
@@ -29,19 +29,26 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "ctMisc.h"
 #include "ctContext.h"
 
-ctNode * ctNode_new(size_t i, ctContext* ctx)
+ctNode * ctNode_new(ctIndex i, ctContext* ctx)
 {
-	ctNode * n = (*(ctx->nodeAlloc))(ctx->cbData);
+	ctNode * n;
+	if (ctx->nodeAlloc) n = (*(ctx->nodeAlloc))(ctx->cbData);
+	else n = (ctNode*) ctArena_alloc( &ct_treeArena(ctx)->nodes );
+	ctMemory_add( &ctx->mem, CT_MEM_NODES, sizeof(ctNode) );
 	n->i = i;
+	n->value = ct_value(ctx,i);
 	n->up = NULL;
 	n->down = NULL;
 	n->children = ctBranchList_init();
+	n->heapPos = CT_NIL;
 	return n;
 }
 
 void ctNode_delete( ctNode * self, ctContext* ctx ) 
 { 
-	(*(ctx->nodeFree))(self,ctx->cbData);
+	ctMemory_sub( &ctx->mem, CT_MEM_NODES, sizeof(ctNode) );
+	if (ctx->nodeFree) (*(ctx->nodeFree))(self,ctx->cbData);
+	else ctArena_free(self);
 }
 
 int ctNode_isMax( ctNode * self ) { return self->up == NULL; }
@@ -114,8 +121,8 @@ ctArc * ctNode_collapse( ctNode * self, ctContext * ctx )
 	if (ctx->mergeArcs)
 		(*(ctx->mergeArcs))( self->up, self->down, ctx->cbData );
 
-	ctBranchList_merge( &(self->up->children), &(self->down->children), ctx );
-	ctBranchList_merge( &(self->up->children), &(self->children), ctx );
+	ctBranchList_append( &(self->up->children), &(self->down->children) );
+	ctBranchList_append( &(self->up->children), &(self->children) );
 	
 	ctNode_removeUpArc(self->down->lo, self->down);
 	ctNode_addUpArc(self->down->lo, self->up);
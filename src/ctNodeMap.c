@@ -1,60 +1,192 @@
 #include "ctNodeMap.h"
 #include "sglib.h"
 
-#define CT_NODEMAP_COMP(X,Y) ((X)->key - (Y)->key)
-
 #include <tourtre.h>
+#include "ctMisc.h"
 #include "ctQueue.h"
 
-SGLIB_DEFINE_RBTREE_PROTOTYPES(ctNodeMap,left,right,color,CT_NODEMAP_COMP)
-
 struct ctNodeMap
 {
-    size_t key;
-    ctNodeMap *left;
-    ctNodeMap *right;
-    ctNode *node;
-    char color;
+    int compact;
+    size_t size;     /* number of entries */
+    size_t capacity; /* of nodes, and of keys if compact */
+    ctNode **nodes;  /* indexed by vertex, or by slot if compact */
+    ctIndex *keys;   /* CT_NIL marks an empty slot */
 };
 
-SGLIB_DEFINE_RBTREE_FUNCTIONS(ctNodeMap,left,right,color,CT_NODEMAP_COMP)
 
-void
-ctNodeMap_insert( ctNodeMap **map, size_t key, ctNode *node )
+/* hash table slot to start probing from. capacity is a power of two, so
+ * the key goes through the murmur3 finalizer first: masking a plain
+ * multiplicative hash keeps only its low bits, and keys a power of two
+ * apart, like one critical point per slice of a grid, would pile up in a
+ * fraction of the table. A 64 bit ctIndex is folded to 32 bits. */
+static
+size_t
+ctNodeMap_slot( const ctNodeMap * m, ctIndex key )
 {
-    ctNodeMap *n = malloc(sizeof(ctNodeMap));
-    n->left = n->right = 0;
-    n->key = key;
-    n->node = node;
+    unsigned long h = (unsigned long) (key ^ ((key >> 16) >> 16)) & 0xffffffffUL;
+    h ^= h >> 16;
+    h = (h * 0x85ebca6bUL) & 0xffffffffUL;
+    h ^= h >> 13;
+    h = (h * 0xc2b2ae35UL) & 0xffffffffUL;
+    h ^= h >> 16;
+    return (size_t) h & (m->capacity-1);
+}
+
+#define CT_NODEMAP_SLOT(M,K) ctNodeMap_slot( M, K )
+
 
-    sglib_ctNodeMap_add(map,n);
+ctNodeMap*
+ctNodeMap_new( size_t numVerts, int compact )
+{
+    ctNodeMap *m = (ctNodeMap*) malloc( sizeof(ctNodeMap) );
+    m->compact = compact;
+    m->size = 0;
+    if ( compact ) {
+        m->capacity = 64;
+        m->keys = (ctIndex*) malloc( m->capacity * sizeof(ctIndex) );
+        memset( m->keys, 0xff, m->capacity * sizeof(ctIndex) );
+        m->nodes = (ctNode**) malloc( m->capacity * sizeof(ctNode*) );
+    } else {
+        m->capacity = numVerts;
+        m->keys = 0;
+        m->nodes = (ctNode**) calloc( numVerts, sizeof(ctNode*) );
+    }
+    return m;
 }
 
+
+void
+ctNodeMap_delete( ctNodeMap *m ) 
+{ 
+    free( m->keys );
+    free( m->nodes );
+    free( m );
+}
+
+
+ctNodeMap*
+ctNodeMap_reuse( ctNodeMap *m, size_t numVerts, int compact )
+{
+    if ( m->compact != compact || (!compact && m->capacity != numVerts) ) {
+        ctNodeMap_delete( m );
+        return ctNodeMap_new( numVerts, compact );
+    }
+    m->size = 0;
+    if ( compact ) memset( m->keys, 0xff, m->capacity * sizeof(ctIndex) );
+    else memset( m->nodes, 0, m->capacity * sizeof(ctNode*) );
+    return m;
+}
+
+
 ctNode*
-ctNodeMap_find( ctNodeMap *map, size_t key )
+ctNodeMap_find( ctNodeMap *m, ctIndex key )
 {
-    ctNodeMap k, *m;
-    k.key = key;
-    m = sglib_ctNodeMap_find_member(map,&k);
-    return (m && m->key==key) ? m->node : 0;
+    size_t s;
+    if ( !m->compact ) return m->nodes[key];
+    for ( s = CT_NODEMAP_SLOT(m,key); m->keys[s] != CT_NIL; s = (s+1) & (m->capacity-1) ) 
+        if ( m->keys[s] == key ) return m->nodes[s];
+    return 0;
 }
 
+
+static
 void
-ctNodeMap_delete( ctNodeMap *map ) 
-{ 
-    struct sglib_ctNodeMap_iterator it;
-    ctNodeMap *i = sglib_ctNodeMap_it_init(&it,map);
-    for (; i; i=sglib_ctNodeMap_it_next(&it) ) free(i); 
+ctNodeMap_grow( ctNodeMap *m )
+{
+    ctIndex *oldKeys = m->keys;
+    ctNode **oldNodes = m->nodes;
+    size_t oldCapacity = m->capacity, i;
+
+    m->capacity *= 2;
+    m->keys = (ctIndex*) malloc( m->capacity * sizeof(ctIndex) );
+    memset( m->keys, 0xff, m->capacity * sizeof(ctIndex) );
+    m->nodes = (ctNode**) malloc( m->capacity * sizeof(ctNode*) );
+    m->size = 0;
+    for ( i = 0; i < oldCapacity; i++ ) 
+        if ( oldKeys[i] != CT_NIL ) ctNodeMap_insert( m, oldKeys[i], oldNodes[i] );
+    free( oldKeys );
+    free( oldNodes );
 }
 
 
+void
+ctNodeMap_insert( ctNodeMap *m, ctIndex key, ctNode *node )
+{
+    size_t s;
+    if ( !m->compact ) {
+        if ( !m->nodes[key] ) m->size++;
+        m->nodes[key] = node;
+        return;
+    }
+    /* keep the load under one half */
+    if ( 2*(m->size+1) > m->capacity ) ctNodeMap_grow( m );
+    for ( s = CT_NODEMAP_SLOT(m,key); m->keys[s] != CT_NIL; s = (s+1) & (m->capacity-1) ) {
+        if ( m->keys[s] == key ) {
+            m->nodes[s] = node;
+            return;
+        }
+    }
+    m->keys[s] = key;
+    m->nodes[s] = node;
+    m->size++;
+}
+
+
+void
+ctNodeMap_remove( ctNodeMap *m, ctIndex key )
+{
+    size_t s, t, home;
+    if ( !m->compact ) {
+        if ( m->nodes[key] ) m->size--;
+        m->nodes[key] = 0;
+        return;
+    }
+    for ( s = CT_NODEMAP_SLOT(m,key); m->keys[s] != key; s = (s+1) & (m->capacity-1) ) 
+        if ( m->keys[s] == CT_NIL ) return;
+    /* shift later entries of the probe run back into the hole, so that
+     * lookups don't stop early at it */
+    for ( t = (s+1) & (m->capacity-1); m->keys[t] != CT_NIL; t = (t+1) & (m->capacity-1) ) {
+        home = CT_NODEMAP_SLOT(m,m->keys[t]);
+        /* t's entry can fill the hole if its home isn't in (s,t] */
+        if ( ((t - home) & (m->capacity-1)) >= ((t - s) & (m->capacity-1)) ) {
+            m->keys[s] = m->keys[t];
+            m->nodes[s] = m->nodes[t];
+            s = t;
+        }
+    }
+    m->keys[s] = CT_NIL;
+    m->size--;
+}
+
+
+size_t
+ctNodeMap_bytes( ctNodeMap *m )
+{
+    return sizeof(ctNodeMap) + m->capacity * 
+        ( sizeof(ctNode*) + (m->compact ? sizeof(ctIndex) : 0) );
+}
+
+
+#define CT_NODE_COMPARE(X,Y) ( (X)->i == (Y)->i ? 0 : (X)->i < (Y)->i ? -1 : 1 )
+
 void 
-ctNodeMap_push_leaves( ctNodeMap *map, ctPriorityQ *pq, struct ctContext* ctx )
+ctNodeMap_push_leaves( ctNodeMap *m, ctPriorityQ *pq, struct ctContext* ctx )
 {
-    struct sglib_ctNodeMap_iterator it;
-    ctNodeMap *i = sglib_ctNodeMap_it_init(&it,map);
-    for (; i; i=sglib_ctNodeMap_it_next(&it)) {
-        if (ctNode_isLeaf(i->node))
-            ctPriorityQ_push(pq,i->node,ctx);
+    size_t i;
+    if ( !m->compact ) {
+        for ( i = 0; i < m->capacity; i++ ) 
+            if ( m->nodes[i] && ctNode_isLeaf(m->nodes[i]) ) 
+                ctPriorityQ_push( pq, m->nodes[i], ctx );
+    } else {
+        /* the table isn't in order, so sort the leaves first */
+        size_t n = 0;
+        ctNode **leaves = (ctNode**) malloc( (m->size+1) * sizeof(ctNode*) );
+        for ( i = 0; i < m->capacity; i++ ) 
+            if ( m->keys[i] != CT_NIL && ctNode_isLeaf(m->nodes[i]) ) 
+                leaves[n++] = m->nodes[i];
+        SGLIB_ARRAY_SINGLE_QUICK_SORT( ctNode*, leaves, n, CT_NODE_COMPARE );
+        for ( i = 0; i < n; i++ ) ctPriorityQ_push( pq, leaves[i], ctx );
+        free( leaves );
     }
 }
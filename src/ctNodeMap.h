@@ -2,20 +2,36 @@
 #define CT_NODEMAP_H
 
 #include <stdlib.h>
+#include "ctIndex.h"
 struct ctNode;
 struct ctPriorityQ;
 struct ctContext;
 
+/* 
+ * Vertex to node map. Either a direct array with an entry per vertex, or,
+ * when compact, an open-addressing hash table that only grows with the
+ * number of entries. 
+ */
 typedef struct ctNodeMap ctNodeMap;
 
-struct ctNode* ctNodeMap_find( ctNodeMap *m, size_t index );
-
-void ctNodeMap_insert( ctNodeMap **m, size_t index, struct ctNode *node );
+ctNodeMap* ctNodeMap_new( size_t numVerts, int compact );
 
 void ctNodeMap_delete( ctNodeMap* );
 
+/* An empty map, as from ctNodeMap_new, made from m's memory if m is of the
+ * same kind. */
+ctNodeMap* ctNodeMap_reuse( ctNodeMap *m, size_t numVerts, int compact );
+
+struct ctNode* ctNodeMap_find( ctNodeMap *m, ctIndex index );
+
+void ctNodeMap_insert( ctNodeMap *m, ctIndex index, struct ctNode *node );
+
+void ctNodeMap_remove( ctNodeMap *m, ctIndex index );
+
+/* push the leaf nodes onto the queue in ascending vertex order */
 void ctNodeMap_push_leaves( struct ctNodeMap*, struct ctPriorityQ*, 
                             struct ctContext* );
 
-#endif
+size_t ctNodeMap_bytes( ctNodeMap* );
 
+#endif
@@ -0,0 +1,128 @@
+/*
+Copyright (c) 2006, Scott E. Dillard
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#define _GNU_SOURCE
+
+#include "ctPerf.h"
+
+#ifdef __linux__
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <string.h>
+#include <unistd.h>
+
+static
+int
+ctPerf_openOne( unsigned int type, unsigned long config )
+{
+    struct perf_event_attr attr;
+    memset( &attr, 0, sizeof(attr) );
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    /* the kernel may share the hardware between more events than it has
+     * counters for, so ask how long each one was really counting */
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int) syscall( __NR_perf_event_open, &attr, 0, -1, -1, 0 );
+}
+
+int
+ctPerf_open( ctPerf * p )
+{
+    static const unsigned int type[CT_NUM_EVENTS] = {
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, 
+        PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE };
+    static const unsigned long config[CT_NUM_EVENTS] = {
+        PERF_COUNT_HW_CPU_CYCLES, 
+        PERF_COUNT_HW_INSTRUCTIONS, 
+        PERF_COUNT_HW_CACHE_LL 
+            | (PERF_COUNT_HW_CACHE_OP_READ << 8) 
+            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_CACHE_DTLB 
+            | (PERF_COUNT_HW_CACHE_OP_READ << 8) 
+            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_BRANCH_MISSES };
+    int e, open = 0;
+
+    for ( e = 0; e < CT_NUM_EVENTS; e++ ) {
+        p->fd[e] = ctPerf_openOne( type[e], config[e] );
+        if ( p->fd[e] < 0 ) { p->fd[e] = -1; continue; }
+        open++;
+    }
+    /* start them together, after all the opening */
+    for ( e = 0; e < CT_NUM_EVENTS; e++ ) 
+        if ( p->fd[e] >= 0 ) ioctl( p->fd[e], PERF_EVENT_IOC_ENABLE, 0 );
+    return open;
+}
+
+void
+ctPerf_close( ctPerf * p, double * counts, int * counted )
+{
+    int e;
+
+    for ( e = 0; e < CT_NUM_EVENTS; e++ ) 
+        if ( p->fd[e] >= 0 ) ioctl( p->fd[e], PERF_EVENT_IOC_DISABLE, 0 );
+
+    for ( e = 0; e < CT_NUM_EVENTS; e++ ) {
+        __u64 v[3];  /* value, time enabled, time running */
+        if ( p->fd[e] < 0 ) continue;
+        if ( read( p->fd[e], v, sizeof(v) ) == (ssize_t) sizeof(v) ) {
+            double n = (double) v[0];
+            if ( v[2] > 0 && v[2] < v[1] ) n *= (double) v[1] / (double) v[2];
+            if ( v[2] > 0 ) {
+                counts[e] += n;
+                counted[e] = 1;
+            }
+        }
+        close( p->fd[e] );
+        p->fd[e] = -1;
+    }
+}
+
+#else
+
+int
+ctPerf_open( ctPerf * p )
+{
+    int e;
+    for ( e = 0; e < CT_NUM_EVENTS; e++ ) p->fd[e] = -1;
+    return 0;
+}
+
+void
+ctPerf_close( ctPerf * p, double * counts, int * counted )
+{
+    (void) p; (void) counts; (void) counted;
+}
+
+#endif
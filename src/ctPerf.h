@@ -0,0 +1,26 @@
+#ifndef CT_PERF_H
+#define CT_PERF_H
+
+#include "tourtre.h"
+
+/*
+ * Hardware event counters for ct_hardwareCounters, through perf_event_open
+ * on Linux. A set is opened by the thread that runs a phase and closed when
+ * the phase ends, so it counts that thread and the ones it starts and joins
+ * in between. Events the machine or the kernel won't count are left out;
+ * elsewhere than Linux nothing is ever counted.
+ */
+
+typedef struct ctPerf
+{
+    int fd[CT_NUM_EVENTS];  /* -1 if not counting */
+} ctPerf;
+
+/* Open and start the counters, and return how many of them are counting. */
+int ctPerf_open( ctPerf * p );
+
+/* Stop and close the counters, adding what they counted to counts and
+ * setting counted for each one that was open. */
+void ctPerf_close( ctPerf * p, double * counts, int * counted );
+
+#endif
@@ -42,10 +42,13 @@ ctLeafQ* ctLeafQ_new ( size_t size )
     
     size_t size2 = 16;
     while( size2 < size ) size2 *= 2;
-    lq->q = (ctComponent**) calloc( size2, sizeof(ctComponent*) );
+    lq->q = (ctLeafQ_Item*) calloc( size2, sizeof(ctLeafQ_Item) );
     lq->head = 0;
     lq->tail = 1;
     lq->size = size2;
+#ifdef CT_STATS
+    lq->grown = 0;
+#endif
     
     if (!lq->q) {
         fprintf(stderr,"ctLeafQ_new: alloc returned null\n");
@@ -60,13 +63,21 @@ void ctLeafQ_delete ( ctLeafQ * self )
     free( self );
 }
 
-void ctLeafQ_pushBack ( ctLeafQ * self, ctComponent * c )
+void ctLeafQ_clear ( ctLeafQ * self )
+{
+    self->head = 0;
+    self->tail = 1;
+}
+
+void ctLeafQ_pushBack ( ctLeafQ * self, ctComponent c, ctComponentType type )
 {
     
     if ( (self->tail+1)%self->size == self->head ) {
         ctLeafQ * newSelf = ctLeafQ_new( self->size * 2 );
+        CT_STATS_COUNT( self->grown );
         while( !ctLeafQ_isEmpty(self) ) {
-            ctLeafQ_pushBack( newSelf, ctLeafQ_popFront( self ) );
+            ctLeafQ_Item i = ctLeafQ_popFront( self );
+            ctLeafQ_pushBack( newSelf, i.c, i.type );
         }
         free( self->q );
         self->q = newSelf->q;
@@ -76,12 +87,13 @@ void ctLeafQ_pushBack ( ctLeafQ * self, ctComponent * c )
         free( newSelf );
     }
 
-    self->q[self->tail] = c;
+    self->q[self->tail].c = c;
+    self->q[self->tail].type = type;
     self->tail = (self->tail+1)%self->size;
 	
 }
 
-ctComponent* ctLeafQ_popFront ( ctLeafQ * self )
+ctLeafQ_Item ctLeafQ_popFront ( ctLeafQ * self )
 {
 	self->head = (self->head+1)%self->size;
 	return self->q[self->head];
@@ -101,14 +113,19 @@ int ctLeafQ_isEmpty ( ctLeafQ * self )
 
 
 
-/* priority Q for branch simplifications, using array-based heap */
+/* priority Q for branch simplifications, using an array-based 4-ary heap.
+ * Each node in it knows its position, so a leaf whose arc changes has its
+ * key updated in place and is never in the heap twice. */
 
 ctPriorityQ* ctPriorityQ_new ( )
 {
 	ctPriorityQ * pq = (ctPriorityQ*) malloc(sizeof(ctPriorityQ));
 	pq->storage = 16;
-	pq->heap = (ctPriorityQ_Item*) calloc( pq->storage, sizeof(ctPriorityQ_Item) );
+	pq->heap = (ctPriorityQ_Item*) malloc( pq->storage * sizeof(ctPriorityQ_Item) );
 	pq->size = 0;
+#ifdef CT_STATS
+	pq->updates = 0;
+#endif
 	return pq;
 }
 
@@ -118,110 +135,102 @@ void ctPriorityQ_delete ( ctPriorityQ * self )
 	free( self );
 }
 
+void ctPriorityQ_clear ( ctPriorityQ * self )
+{
+	size_t i;
+	for ( i = 0; i < self->size; i++ ) self->heap[i].n->heapPos = CT_NIL;
+	self->size = 0;
+}
+
 int ctPriorityQ_isEmpty ( ctPriorityQ * self )
 {
 	return self->size == 0;
 }
 
-void ctPriorityQ_pushHeap ( ctPriorityQ * self, ctPriorityQ_Item item )
+
+/* ties go to the lower vertex, so the order doesn't depend on the heap */
+#define CT_PQ_LESS(A,B) \
+    ( (A).p < (B).p || ( (A).p == (B).p && (A).n->i < (B).n->i ) )
+
+#define CT_PQ_ARITY 4
+
+
+static void ctPriorityQ_place ( ctPriorityQ * self, size_t pos, ctPriorityQ_Item item )
 {
-    /* resize array if necessary */
-    if (self->size == self->storage ) {
-        ctPriorityQ_Item * newHeap;
-        size_t i;
+    self->heap[pos] = item;
+    item.n->heapPos = pos;
+}
 
-        self->storage *= 2;
-        newHeap = (ctPriorityQ_Item*) calloc( self->storage, sizeof(ctPriorityQ_Item) );
-        for ( i = 0; i < self->size; i++ ) newHeap[i] = self->heap[i];
-        free(self->heap);
-        self->heap = newHeap;
+static void ctPriorityQ_siftUp ( ctPriorityQ * self, size_t c, ctPriorityQ_Item item )
+{
+    while ( c > 0 ) {
+        size_t p = (c-1) / CT_PQ_ARITY;
+        if ( !CT_PQ_LESS( item, self->heap[p] ) ) break;
+        ctPriorityQ_place( self, c, self->heap[p] );
+        c = p;
     }
+    ctPriorityQ_place( self, c, item );
+}
 
-    self->heap[ self->size++ ] = item;
-
-    {   /* push heap */
-        size_t c = self->size-1;
-        while(1) {
-            if ( c > 0 ) {
-                size_t p = (c-1)/2;
-                if ( self->heap[p].p > self->heap[c].p ) {
-                    ctPriorityQ_Item tmp = self->heap[p];
-                    self->heap[p] = self->heap[c];
-                    self->heap[c] = tmp;
-                    c = p;
-                } else {
-                    break;
-                }
-            } else {
-                break;
-            }
-        }
+static void ctPriorityQ_siftDown ( ctPriorityQ * self, size_t p, ctPriorityQ_Item item )
+{
+    while (1) {
+        size_t first = p*CT_PQ_ARITY + 1, c, min;
+        if ( first >= self->size ) break;
+        /* min is the least child */
+        min = first;
+        for ( c = first+1; c < first+CT_PQ_ARITY && c < self->size; c++ ) 
+            if ( CT_PQ_LESS( self->heap[c], self->heap[min] ) ) min = c;
+        if ( !CT_PQ_LESS( self->heap[min], item ) ) break;
+        ctPriorityQ_place( self, p, self->heap[min] );
+        p = min;
     }
+    ctPriorityQ_place( self, p, item );
 }
 
 
-void ctPriorityQ_push ( ctPriorityQ* self, ctNode* node, ctContext* ctx )
+double ctPriorityQ_priority ( ctNode* node, ctContext* ctx )
 {
-    ctPriorityQ_Item item;
-    item.n = node;
-
     if (ctx->priority) {
         /* user defined priority */
-        item.p = (*(ctx->priority))( node, ctx->cbData );
+        return (*(ctx->priority))( node, ctx->cbData );
     } else {
         /* default: persistence */
-        item.p =    
-            fabs( (*(ctx->value))(node->i, ctx->cbData) 
-                - (*ctx->value)(ctNode_otherNode(node)->i, ctx->cbData) );
+        return fabs( node->value - ctNode_otherNode(node)->value );
     }
-
-    item.o = ctNode_otherNode(node)->i;
-    ctPriorityQ_pushHeap(self,item);
 }
 
 
-ctPriorityQ_Item ctPriorityQ_popHeap( ctPriorityQ * self )
+void ctPriorityQ_push ( ctPriorityQ* self, ctNode* node, ctContext* ctx )
 {
-    ctPriorityQ_Item r = self->heap[0];
-    size_t p = 0;
-
-    self->heap[0] = self->heap[--self->size];
+    ctPriorityQ_Item item;
+    item.n = node;
+    item.p = ctPriorityQ_priority( node, ctx );
+
+    if ( node->heapPos != CT_NIL ) {
+        /* already in, with the priority of the arc it had then */
+        size_t pos = node->heapPos;
+        CT_STATS_COUNT( self->updates );
+        if ( CT_PQ_LESS( item, self->heap[pos] ) ) ctPriorityQ_siftUp( self, pos, item );
+        else ctPriorityQ_siftDown( self, pos, item );
+        return;
+    }
 
-    while(1) {
-        size_t c = p*2+1;
-        if ( c < self->size ) {
-            if ( c+1 < self->size && self->heap[c+1].p < self->heap[c].p ) c = p*2+2;
-            /* c is the min child */
-            
-            if ( self->heap[p].p > self->heap[c].p ) {
-                ctPriorityQ_Item tmp = self->heap[p];
-                self->heap[p] = self->heap[c];
-                self->heap[c] = tmp;
-                p = c;
-            } else break;		
-        } else break;
+    if ( self->size == self->storage ) {
+        self->storage *= 2;
+        self->heap = (ctPriorityQ_Item*) realloc( self->heap, 
+            self->storage * sizeof(ctPriorityQ_Item) );
     }
-    return r;
+    ctPriorityQ_siftUp( self, self->size++, item );
 }
 
-   
+
 ctNode* ctPriorityQ_pop ( ctPriorityQ * self, ctContext * ctx )
 {
-    while(1) {
-        assert( self->size != 0 );
-        {
-            ctPriorityQ_Item i = ctPriorityQ_popHeap(self);
-            if ( ctNode_otherNode(i.n)->i != i.o ) {
-                /* invalidated priority because of other simplifications */
-                ctPriorityQ_push(self, i.n, ctx);
-                continue;
-            }
-            /* didn't continue? must be valid */
-            return i.n;
-        }
-    }
+    ctNode *n;
+    assert( self->size != 0 );
+    n = self->heap[0].n;
+    n->heapPos = CT_NIL;
+    if ( --self->size > 0 ) ctPriorityQ_siftDown( self, 0, self->heap[self->size] );
+    return n;
 }
-
-
-
-
@@ -32,22 +32,31 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "ctComponent.h"
 
 struct ctContext;
-struct ctComponent;
 struct ctNode;
 
+/* A leaf component, and which tree it is from */
+typedef struct ctLeafQ_Item {
+	ctComponent c;
+	ctComponentType type;
+} ctLeafQ_Item;
+
 typedef struct ctLeafQ {
 
-	struct ctComponent ** q;
+	ctLeafQ_Item * q;
 	size_t head,tail,size;
+#ifdef CT_STATS
+	size_t grown; /* times it grew, until ct_merge moves it to ct_stats */
+#endif
 
 } ctLeafQ;
 
 
-    ctLeafQ*  ctLeafQ_new      ( size_t size );
-        void  ctLeafQ_delete   ( ctLeafQ * self );
-        void  ctLeafQ_pushBack ( ctLeafQ * self, struct ctComponent * c );
-ctComponent*  ctLeafQ_popFront ( ctLeafQ * self );
-         int  ctLeafQ_isEmpty    ( ctLeafQ * self );
+     ctLeafQ*  ctLeafQ_new      ( size_t size );
+         void  ctLeafQ_delete   ( ctLeafQ * self );
+         void  ctLeafQ_clear    ( ctLeafQ * self );
+         void  ctLeafQ_pushBack ( ctLeafQ * self, ctComponent c, ctComponentType type );
+ctLeafQ_Item  ctLeafQ_popFront ( ctLeafQ * self );
+          int  ctLeafQ_isEmpty    ( ctLeafQ * self );
 
 
 
@@ -57,27 +66,30 @@ ctComponent*  ctLeafQ_popFront ( ctLeafQ * self );
 typedef struct ctPriorityQ_Item {
 	struct ctNode * n; /* leaf node */
 	double p; /* priority */
-	size_t o; /* vertex at the other end of leaf arc (used to check validity */
 } ctPriorityQ_Item;
 
 
 typedef struct ctPriorityQ {
 	ctPriorityQ_Item * heap;
 	size_t size, storage;
+#ifdef CT_STATS
+	size_t updates; /* pushes of queued nodes, until moved to ct_stats */
+#endif
 } ctPriorityQ;
 
 
 ctPriorityQ*  ctPriorityQ_new    ( );
         void  ctPriorityQ_delete ( ctPriorityQ * self );
+        void  ctPriorityQ_clear  ( ctPriorityQ * self );
          int  ctPriorityQ_isEmpty  ( ctPriorityQ * self );
         
-/* these are the modified priority q functions described in the Toporrery paper */
+/* push a leaf, or if it is in already, update its priority after its arc
+ * changed. Nodes keep their heap position in ctNode::heapPos. */
 		void  ctPriorityQ_push   ( ctPriorityQ * self, struct ctNode * node, struct ctContext * ctx );
      ctNode*  ctPriorityQ_pop    ( ctPriorityQ * self, struct ctContext * ctx);
 
-/* these are plain heap functions, called by the above functions */
-ctPriorityQ_Item  ctPriorityQ_popHeap  ( ctPriorityQ * self );
-            void  ctPriorityQ_pushHeap ( ctPriorityQ * self, ctPriorityQ_Item item );
+/* simplification priority of a leaf node: ctx->priority, or persistence */
+      double  ctPriorityQ_priority ( struct ctNode * leaf, struct ctContext * ctx );
 
 
 #endif
@@ -0,0 +1,92 @@
+/*
+Copyright (c) 2006, Scott E. Dillard
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/* for mkstemp, ftruncate, mmap and posix_madvise */
+#define _XOPEN_SOURCE 600
+
+#include "ctScratch.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+
+void* 
+ctScratch_alloc( const char * dir, size_t bytes, int * mapped )
+{
+    char * path;
+    int fd;
+    void * p;
+
+    *mapped = 0;
+    if ( !dir ) return malloc( bytes );
+
+    path = (char*) malloc( strlen(dir) + 32 );
+    sprintf( path, "%s/tourtre.XXXXXX", dir );
+    fd = mkstemp( path );
+    if ( fd < 0 ) {
+        fprintf(stderr,"ctScratch_alloc: can't create a file in %s, "
+                       "using memory instead\n", dir);
+        free( path );
+        return malloc( bytes );
+    }
+    unlink( path );
+    free( path );
+
+    p = MAP_FAILED;
+    if ( ftruncate( fd, (off_t)bytes ) == 0 ) 
+        p = mmap( NULL, bytes, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0 );
+    close( fd ); /* the mapping keeps the file */
+
+    if ( p == MAP_FAILED ) {
+        fprintf(stderr,"ctScratch_alloc: can't map %lu bytes, "
+                       "using memory instead\n", (unsigned long)bytes);
+        return malloc( bytes );
+    }
+    *mapped = 1;
+    return p;
+}
+
+
+void 
+ctScratch_free( void * p, size_t bytes, int mapped )
+{
+    if ( !p ) return;
+    if ( mapped ) munmap( p, bytes );
+    else free( p );
+}
+
+
+void 
+ctScratch_advise( void * p, size_t bytes, int mapped, ctScratch_Access a )
+{
+    if ( !p || !mapped ) return;
+    posix_madvise( p, bytes, a == CT_SCRATCH_SEQUENTIAL ? 
+        POSIX_MADV_SEQUENTIAL : POSIX_MADV_RANDOM );
+}
@@ -0,0 +1,23 @@
+#ifndef CT_SCRATCH_H
+#define CT_SCRATCH_H
+
+#include <stdlib.h>
+
+/* 
+ * Storage for the big per-vertex arrays. With a directory, each array is a
+ * memory-mapped, already unlinked file in it, so that the kernel can page
+ * the arrays out to that file instead of to swap. Without one it is plain
+ * malloc. *mapped says which it was, to pass back to ctScratch_free.
+ */
+
+typedef enum ctScratch_Access
+{
+    CT_SCRATCH_RANDOM,     /* no readahead */
+    CT_SCRATCH_SEQUENTIAL  /* aggressive readahead, drop pages behind */
+} ctScratch_Access;
+
+void* ctScratch_alloc  ( const char * dir, size_t bytes, int * mapped );
+void  ctScratch_free   ( void * p, size_t bytes, int mapped );
+void  ctScratch_advise ( void * p, size_t bytes, int mapped, ctScratch_Access a );
+
+#endif
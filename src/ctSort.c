@@ -0,0 +1,245 @@
+/*
+Copyright (c) 2006, Scott E. Dillard
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <limits.h>
+#include <string.h>
+
+#include "ctSort.h"
+#include "ctThread.h"
+
+
+#define CT_SORT_RADIX 256
+
+/* chunks smaller than this aren't worth a thread */
+#define CT_SORT_CHUNK ((size_t)1 << 16)
+
+
+double 
+ctSort_value( const void * values, ctValueType type, ctIndex v )
+{
+    switch ( type ) {
+        case CT_VALUE_UINT8:  return ((const unsigned char*)values)[v];
+        case CT_VALUE_UINT16: return ((const unsigned short*)values)[v];
+        case CT_VALUE_FLOAT:  return ((const float*)values)[v];
+        default:              return ((const double*)values)[v];
+    }
+}
+
+
+/* One pass, stable, so equal values stay in index order. */
+static
+void
+ctSort_counting( const void * values, ctValueType type, size_t n, 
+                 ctIndex * order )
+{
+    const unsigned char *v8 = (const unsigned char*) values;
+    const unsigned short *v16 = (const unsigned short*) values;
+    int wide = (type == CT_VALUE_UINT16);
+    size_t numKeys = wide ? (size_t)USHRT_MAX + 1 : (size_t)UCHAR_MAX + 1;
+    size_t *start = (size_t*) calloc( numKeys, sizeof(size_t) );
+    size_t i, k, sum = 0;
+
+    for ( i = 0; i < n; i++ ) start[ wide ? v16[i] : v8[i] ]++;
+    for ( k = 0; k < numKeys; k++ ) {
+        size_t c = start[k];
+        start[k] = sum;
+        sum += c;
+    }
+    for ( i = 0; i < n; i++ ) order[ start[ wide ? v16[i] : v8[i] ]++ ] = i;
+
+    free( start );
+}
+
+
+/* 
+ * The radix sort works on the bits of each value, rearranged so that they
+ * compare as unsigned integers in the same order as the values do. key[0]
+ * is the least significant byte. 
+ */
+typedef struct ctSort_Item
+{
+    unsigned char key[sizeof(double)];
+    ctIndex i;
+} ctSort_Item;
+
+
+/* One worker's share of the items, for one pass. */
+typedef struct ctSort_Task
+{
+    const unsigned char *values;
+    size_t width;   /* sizeof the value type */
+    int little;     /* values are stored least significant byte first */
+    ctSort_Item *src, *dst;
+    size_t start, end;
+    size_t digit;   /* key byte this pass sorts on */
+    size_t count[CT_SORT_RADIX]; /* histogram, then where each digit goes */
+} ctSort_Task;
+
+
+static
+void
+ctSort_keyTask( void * arg )
+{
+    ctSort_Task *t = (ctSort_Task*) arg;
+    size_t w = t->width, i, b;
+
+    for ( i = t->start; i < t->end; i++ ) {
+        const unsigned char *raw = t->values + i*w;
+        unsigned char *key = t->src[i].key;
+        int zero;
+
+        for ( b = 0; b < w; b++ ) key[b] = t->little ? raw[b] : raw[w-1-b];
+        zero = !(key[w-1] & 0x7f);
+        for ( b = 0; b+1 < w; b++ ) if ( key[b] ) zero = 0;
+        if ( zero ) key[w-1] = 0; /* -0 is +0 */
+
+        if ( key[w-1] & 0x80 ) {
+            for ( b = 0; b < w; b++ ) key[b] = (unsigned char) ~key[b];
+        } else {
+            key[w-1] |= 0x80;
+        }
+        t->src[i].i = i;
+    }
+}
+
+
+static
+void
+ctSort_countTask( void * arg )
+{
+    ctSort_Task *t = (ctSort_Task*) arg;
+    size_t i;
+
+    memset( t->count, 0, sizeof(t->count) );
+    for ( i = t->start; i < t->end; i++ ) t->count[ t->src[i].key[t->digit] ]++;
+}
+
+
+static
+void
+ctSort_scatterTask( void * arg )
+{
+    ctSort_Task *t = (ctSort_Task*) arg;
+    size_t i;
+
+    for ( i = t->start; i < t->end; i++ ) 
+        t->dst[ t->count[ t->src[i].key[t->digit] ]++ ] = t->src[i];
+}
+
+
+static
+void
+ctSort_radix( const void * values, size_t width, size_t n, ctIndex * order, 
+              size_t numWorkers )
+{
+    ctSort_Item *src = (ctSort_Item*) malloc( n * sizeof(ctSort_Item) );
+    ctSort_Item *dst = (ctSort_Item*) malloc( n * sizeof(ctSort_Item) );
+    ctSort_Task *tasks = (ctSort_Task*) malloc( numWorkers * sizeof(ctSort_Task) );
+    ctThread_func *fn = (ctThread_func*) malloc( numWorkers * sizeof(ctThread_func) );
+    void **arg = (void**) malloc( numWorkers * sizeof(void*) );
+    size_t digit, d, k, i;
+
+    /* 1.0 has its 0x3f byte most significant */
+    unsigned char one[sizeof(double)];
+    float oneF = 1.0f;
+    double oneD = 1.0;
+    if ( width == sizeof(float) ) memcpy( one, &oneF, width );
+    else memcpy( one, &oneD, width );
+
+    for ( k = 0; k < numWorkers; k++ ) {
+        tasks[k].values = (const unsigned char*) values;
+        tasks[k].width = width;
+        tasks[k].little = (one[width-1] == 0x3f);
+        tasks[k].start = n*k/numWorkers;
+        tasks[k].end = n*(k+1)/numWorkers;
+        arg[k] = &tasks[k];
+        fn[k] = ctSort_keyTask;
+        tasks[k].src = src;
+    }
+    ctThread_runAll( numWorkers, fn, arg );
+
+    /* least significant digit first. Each pass is stable, and the items
+     * start out in index order, so ties end up broken by index */
+    for ( digit = 0; digit < width; digit++ ) {
+        size_t sum = 0;
+        int skip = 0;
+
+        for ( k = 0; k < numWorkers; k++ ) {
+            tasks[k].src = src;
+            tasks[k].dst = dst;
+            tasks[k].digit = digit;
+            fn[k] = ctSort_countTask;
+        }
+        ctThread_runAll( numWorkers, fn, arg );
+
+        /* worker k's items with digit d go after everyone's smaller digits
+         * and after workers 0..k-1's items with digit d */
+        for ( d = 0; d < CT_SORT_RADIX; d++ ) {
+            size_t total = 0;
+            for ( k = 0; k < numWorkers; k++ ) {
+                size_t c = tasks[k].count[d];
+                tasks[k].count[d] = sum + total;
+                total += c;
+            }
+            if ( total == n ) skip = 1; /* everyone has the same digit */
+            sum += total;
+        }
+        if ( skip ) continue;
+
+        for ( k = 0; k < numWorkers; k++ ) fn[k] = ctSort_scatterTask;
+        ctThread_runAll( numWorkers, fn, arg );
+
+        { ctSort_Item *tmp = src; src = dst; dst = tmp; }
+    }
+
+    for ( i = 0; i < n; i++ ) order[i] = src[i].i;
+
+    free( arg );
+    free( fn );
+    free( tasks );
+    free( dst );
+    free( src );
+}
+
+
+void 
+ctSort_vertices( const void * values, ctValueType type, size_t n, 
+                 ctIndex * order, size_t numWorkers )
+{
+    if ( n == 0 ) return;
+
+    if ( type == CT_VALUE_UINT8 || type == CT_VALUE_UINT16 ) {
+        ctSort_counting( values, type, n, order );
+        return;
+    }
+
+    if ( numWorkers > n / CT_SORT_CHUNK ) numWorkers = n / CT_SORT_CHUNK;
+    if ( numWorkers < 1 ) numWorkers = 1;
+    
+    ctSort_radix( values, 
+        type == CT_VALUE_FLOAT ? sizeof(float) : sizeof(double),
+        n, order, numWorkers );
+}
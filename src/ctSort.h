@@ -0,0 +1,20 @@
+#ifndef CT_SORT_H
+#define CT_SORT_H
+
+#include <stdlib.h>
+#include "tourtre.h"
+
+/* 
+ * Vertex ordering from a raw value array, for ct_sortVertices and
+ * ct_initFromValues. Vertices are sorted by value, ties broken by index,
+ * which is the simulation of simplicity the sweeps expect. 8 and 16 bit
+ * values take one counting-sort pass; floats and doubles take an LSD radix
+ * sort on their bits, split over numWorkers threads. 
+ */
+void ctSort_vertices( const void * values, ctValueType type, size_t n, 
+                      ctIndex * order, size_t numWorkers );
+
+/* Value of vertex v, as a double. */
+double ctSort_value( const void * values, ctValueType type, ctIndex v );
+
+#endif
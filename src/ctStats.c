@@ -0,0 +1,124 @@
+/*
+Copyright (c) 2006, Scott E. Dillard
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+#define _POSIX_C_SOURCE 199309L
+
+#include "tourtre.h"
+#include "ctContext.h"
+#include "ctStats.h"
+
+#include <string.h>
+#include <time.h>
+
+
+#ifdef CT_STATS
+
+double
+ctStats_now( void )
+{
+    struct timespec t;
+    clock_gettime( CLOCK_MONOTONIC, &t );
+    return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+
+void
+ctStats_begin( ctContext * ctx, ctPhase phase )
+{
+    if ( ctx->statsEvents ) ctPerf_open( &ctx->statsPerf[phase] );
+    ctx->statsStart[phase] = ctStats_now();
+}
+
+
+void
+ctStats_end( ctContext * ctx, ctPhase phase )
+{
+    ctx->stats.seconds[phase] += ctStats_now() - ctx->statsStart[phase];
+    if ( ctx->statsEvents ) 
+        ctPerf_close( &ctx->statsPerf[phase], ctx->stats.events[phase], ctx->statsCounted[phase] );
+}
+
+#endif
+
+
+ctStats
+ct_stats( ctContext * ctx )
+{
+#ifdef CT_STATS
+    ctStats s = ctx->stats;
+    int p, e;
+    s.enabled = 1;
+    for ( p = 0; p < CT_NUM_PHASES; p++ ) 
+        for ( e = 0; e < CT_NUM_EVENTS; e++ ) 
+            s.eventCounted[e] |= ctx->statsCounted[p][e];
+    return s;
+#else
+    ctStats s;
+    (void) ctx;
+    memset( &s, 0, sizeof(s) );
+    return s;
+#endif
+}
+
+
+void
+ct_clearStats( ctContext * ctx )
+{
+#ifdef CT_STATS
+    memset( &ctx->stats, 0, sizeof(ctx->stats) );
+    memset( ctx->statsCounted, 0, sizeof(ctx->statsCounted) );
+#else
+    (void) ctx;
+#endif
+}
+
+
+int
+ct_hardwareCounters( ctContext * ctx, int on )
+{
+#ifdef CT_STATS
+    ctPerf p;
+    double counts[CT_NUM_EVENTS];
+    int counted[CT_NUM_EVENTS], n;
+
+    ctx->statsEvents = 0;
+    if ( !on ) return 0;
+
+    /* try them once here, so the caller knows what to expect */
+    memset( counts, 0, sizeof(counts) );
+    memset( counted, 0, sizeof(counted) );
+    n = ctPerf_open( &p );
+    ctPerf_close( &p, counts, counted );
+    ctx->statsEvents = n > 0;
+    return n;
+#else
+    (void) ctx;
+    (void) on;
+    return 0;
+#endif
+}
@@ -0,0 +1,55 @@
+#ifndef CT_STATS_H
+#define CT_STATS_H
+
+#include "tourtre.h"
+
+/*
+ * Counters and timers for ct_stats. They are only compiled in when the
+ * library is built with CT_STATS defined; otherwise every macro here is
+ * empty and doesn't evaluate its arguments, and the fields they touch
+ * don't exist. The sweeps each have their own counters and timers, so
+ * they can run at the same time; everything else is serial.
+ */
+#ifdef CT_STATS
+
+double ctStats_now( void );
+
+/* start and stop the timer of a phase, and its counters if they're on */
+void ctStats_begin( ctContext * ctx, ctPhase phase );
+void ctStats_end( ctContext * ctx, ctPhase phase );
+
+/* slots of ctContext.statsStart past the phases, for neighbor callbacks */
+#define CT_STATS_CALL_START CT_NUM_PHASES
+#define CT_STATS_NUM_STARTS (CT_NUM_PHASES + 2)
+
+#define CT_STATS_ADD(ctx,field,n) ( (ctx)->stats.field += (n) )
+
+/* add a counter kept by a queue or store to field, and zero it */
+#define CT_STATS_MOVE(ctx,field,counter) \
+    ( (ctx)->stats.field += (counter), (counter) = 0 )
+
+#define CT_STATS_COUNT(counter) ( (counter)++ )
+
+#define CT_STATS_BEGIN(ctx,phase) ctStats_begin( ctx, phase )
+#define CT_STATS_END(ctx,phase) ctStats_end( ctx, phase )
+
+#define CT_STATS_CALL_BEGIN(ctx,worker) \
+    ( (ctx)->statsStart[CT_STATS_CALL_START + (worker)] = ctStats_now() )
+#define CT_STATS_CALL_END(ctx,worker) \
+    ( (ctx)->stats.sweep[worker].neighborCalls++, \
+      (ctx)->stats.sweep[worker].neighborSeconds += \
+          ctStats_now() - (ctx)->statsStart[CT_STATS_CALL_START + (worker)] )
+
+#else
+
+#define CT_STATS_ADD(ctx,field,n) ((void)0)
+#define CT_STATS_MOVE(ctx,field,counter) ((void)0)
+#define CT_STATS_COUNT(counter) ((void)0)
+#define CT_STATS_BEGIN(ctx,phase) ((void)0)
+#define CT_STATS_END(ctx,phase) ((void)0)
+#define CT_STATS_CALL_BEGIN(ctx,worker) ((void)0)
+#define CT_STATS_CALL_END(ctx,worker) ((void)0)
+
+#endif
+
+#endif
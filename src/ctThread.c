@@ -0,0 +1,175 @@
+/*
+Copyright (c) 2006, Scott E. Dillard
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+    this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above copyright notice,
+    this list of conditions and the following disclaimer in the documentation
+    and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include "ctThread.h"
+
+#ifndef CT_NO_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+
+typedef struct ctThread_Task
+{
+    ctThread_func fn;
+    void * arg;
+} ctThread_Task;
+
+
+#ifndef CT_NO_THREADS
+static void *
+ctThread_start( void * t )
+{
+    ctThread_Task * task = (ctThread_Task*) t;
+    (*(task->fn))(task->arg);
+    return NULL;
+}
+#endif
+
+
+void 
+ctThread_runAll( size_t n, ctThread_func * fn, void ** arg )
+{
+#ifdef CT_NO_THREADS
+    size_t k;
+    for ( k = 0; k < n; k++ ) (*(fn[k]))(arg[k]);
+#else
+    size_t k;
+    ctThread_Task * tasks;
+    pthread_t * threads;
+    int * started;
+
+    if ( n == 0 ) return;
+    if ( n == 1 ) { 
+        (*(fn[0]))(arg[0]); 
+        return; 
+    }
+
+    tasks = (ctThread_Task*) malloc( n * sizeof(ctThread_Task) );
+    threads = (pthread_t*) malloc( n * sizeof(pthread_t) );
+    started = (int*) calloc( n, sizeof(int) );
+
+    for ( k = 1; k < n; k++ ) {
+        tasks[k].fn = fn[k];
+        tasks[k].arg = arg[k];
+        started[k] = 
+            pthread_create( &threads[k], NULL, ctThread_start, &tasks[k] ) == 0;
+    }
+
+    (*(fn[0]))(arg[0]);
+
+    for ( k = 1; k < n; k++ ) {
+        if ( started[k] ) pthread_join( threads[k], NULL );
+        else (*(fn[k]))(arg[k]);
+    }
+
+    free( started );
+    free( threads );
+    free( tasks );
+#endif
+}
+
+
+struct ctThread_Mutex
+{
+#ifdef CT_NO_THREADS
+    int unused;
+#else
+    pthread_mutex_t m;
+#endif
+};
+
+ctThread_Mutex* 
+ctThread_mutexNew( void )
+{
+    ctThread_Mutex * m = (ctThread_Mutex*) malloc( sizeof(ctThread_Mutex) );
+#ifndef CT_NO_THREADS
+    pthread_mutex_init( &m->m, NULL );
+#endif
+    return m;
+}
+
+void 
+ctThread_mutexDelete( ctThread_Mutex * m )
+{
+#ifndef CT_NO_THREADS
+    pthread_mutex_destroy( &m->m );
+#endif
+    free( m );
+}
+
+void 
+ctThread_lock( ctThread_Mutex * m )
+{
+#ifndef CT_NO_THREADS
+    pthread_mutex_lock( &m->m );
+#else
+    (void)m;
+#endif
+}
+
+void 
+ctThread_unlock( ctThread_Mutex * m )
+{
+#ifndef CT_NO_THREADS
+    pthread_mutex_unlock( &m->m );
+#else
+    (void)m;
+#endif
+}
+
+
+size_t 
+ctThread_numCores( void )
+{
+#if !defined(CT_NO_THREADS) && defined(_SC_NPROCESSORS_ONLN)
+    long n = sysconf( _SC_NPROCESSORS_ONLN );
+    return n > 0 ? (size_t)n : 1;
+#else
+    return 1;
+#endif
+}
+
+
+static size_t ctThread_limit = 0;
+
+size_t 
+ctThread_numThreads( void )
+{
+#ifdef CT_NO_THREADS
+    return 1;
+#else
+    return ctThread_limit ? ctThread_limit : ctThread_numCores();
+#endif
+}
+
+void 
+ctThread_setNumThreads( size_t n )
+{
+    ctThread_limit = n;
+}
@@ -0,0 +1,44 @@
+#ifndef CT_THREAD_H
+#define CT_THREAD_H
+
+#include <stdlib.h>
+
+/* 
+ * Minimal threading support. Everything in the library that runs in
+ * parallel goes through here, so defining CT_NO_THREADS when building the
+ * library makes all of it run serially on the calling thread. 
+ */
+
+typedef void (*ctThread_func)( void * arg );
+
+/* 
+ * Call fn[k](arg[k]) for each k < n, concurrently, and return when all of
+ * them are done. The calling thread runs task 0 itself. If a thread can't
+ * be started, its task is run on the calling thread instead. 
+ */
+void ctThread_runAll( size_t n, ctThread_func * fn, void ** arg );
+
+/* 
+ * Number of processors available, or 1 if that can't be found out or
+ * threads are disabled. 
+ */
+size_t ctThread_numCores( void );
+
+/* 
+ * Number of threads the library's parallel steps may use: the number set
+ * with ctThread_setNumThreads, or ctThread_numCores if that is 0. 
+ */
+size_t ctThread_numThreads( void );
+void ctThread_setNumThreads( size_t n );
+
+/* 
+ * A lock. Without threads it does nothing. 
+ */
+typedef struct ctThread_Mutex ctThread_Mutex;
+
+ctThread_Mutex* ctThread_mutexNew( void );
+void ctThread_mutexDelete( ctThread_Mutex * m );
+void ctThread_lock( ctThread_Mutex * m );
+void ctThread_unlock( ctThread_Mutex * m );
+
+#endif
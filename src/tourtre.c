@@ -28,28 +28,31 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "tourtre.h"
 
 #include <stdio.h>
+#include <math.h>
 
 #include "ctQueue.h"
 #include "ctMisc.h"
 #include "ctComponent.h"
-#include "ctAlloc.h"
 #include "ctContext.h"
 #include "ctNodeMap.h"
-#include "sglib.h"
+#include "ctThread.h"
+#include "ctScratch.h"
+#include "ctSort.h"
 
 /* local functions */
 static
-ctComponent* ct_sweep ( size_t start, 
+ctComponent ct_sweep ( size_t start, 
                         size_t end, 
                         int inc, 
-                        ctComponentType type, 
-                        ctComponent *comps[],
-                        size_t * next, 
+                        ctComponentStore *cs, 
+                        ctComponent comps[],
+                        ctIndex * next, 
+                        size_t worker,
                         ctContext * ctx );
 
 static
 void    
-ct_augment ( ctContext * ctx );
+ct_augment ( ctContext * ctx, size_t numWorkers );
 
 static
 ctArc* ct_merge ( ctContext * ctx );
@@ -58,15 +61,48 @@ static
 void  
 ct_checkContext ( ctContext * ctx );
 
+static
+void
+ct_syncMemory ( ctContext * ctx );
+
+static
+void
+ct_freeArcMap ( ctContext * ctx );
+
+static
+void
+ct_freeNodeMap ( ctContext * ctx );
+
+static
+void
+ct_releaseTreeArena ( ctContext * ctx, ctTreeArena * ta );
+
+static
+void
+ct_freeSweeps ( ctContext * ctx );
+
+static
+const char *
+ct_defaultScratchDir ( void );
+
+static
+const char *
+ct_scratchDir ( ctContext * ctx );
+
+static
+void
+ct_releaseWorking ( ctContext * ctx );
+
+
 
 
 
 ctContext* 
 ct_init
 (   size_t  numVerts,
-    size_t  *totalOrder, 
-    double  (*value)( size_t v, void* ),
-    size_t  (*neighbors)( size_t v, size_t* nbrs, void* ),
+    ctIndex *totalOrder, 
+    double  (*value)( ctIndex v, void* ),
+    size_t  (*neighbors)( ctIndex v, ctIndex* nbrs, void* ),
      void*  cbData
 )
 {
@@ -75,39 +111,24 @@ ct_init
     /* zero-out the struct */
     memset(ctx, 0, sizeof(ctContext) );
     
-    /* set default values */
+    /* set default values. The allocators are NULL, for the arenas */
     ctx->maxValence = 256;
-    ctx->arcAlloc = ct_arcMalloc;
-    ctx->arcFree = ct_arcFree;
-    ctx->nodeAlloc = ct_nodeMalloc;
-    ctx->nodeFree = ct_nodeFree;
-    ctx->branchAlloc = ct_branchMalloc;
-    ctx->branchFree = ct_branchFree;
     
     /* get parameter values */
     ctx->numVerts = numVerts;
     ctx->totalOrder = totalOrder;
     ctx->value = value;
     ctx->neighbors = neighbors;
+    ctx->domain = CT_DOMAIN_CALLBACK;
     ctx->cbData = cbData;
     
-    /* create working mem */
-    ctx->numVerts = numVerts;
-    ctx->joinRoot = NULL;
-    ctx->splitRoot = NULL;
-   
-    
-    ctx->joinComps = calloc( sizeof(ctComponent*), ctx->numVerts );
-    memset(ctx->joinComps,0x0,sizeof(ctComponent*)*ctx->numVerts );
-    
-    ctx->splitComps = calloc( sizeof(ctComponent*), ctx->numVerts );
-    memset(ctx->splitComps,0x0,sizeof(ctComponent*)*ctx->numVerts );
-
-    ctx->nextJoin = calloc( sizeof(size_t), ctx->numVerts );
-    memset(ctx->nextJoin,CT_NIL,sizeof(size_t)*ctx->numVerts );
-    
-    ctx->nextSplit = calloc( sizeof(size_t), ctx->numVerts );
-    memset(ctx->nextSplit,CT_NIL,sizeof(size_t)*ctx->numVerts );
+    /* working mem is allocated by the phase that first needs it */
+    ctx->joinRoot = CT_NIL;
+    ctx->splitRoot = CT_NIL;
+    ctComponentStore_init( &ctx->joinStore, CT_JOIN_COMPONENT );
+    ctComponentStore_init( &ctx->splitStore, CT_SPLIT_COMPONENT );
+    ctx->joinComps = ctx->splitComps = 0;
+    ctx->nextJoin = ctx->nextSplit = 0;
 
     ctx->arcMap = 0;
     ctx->arcMapOwned = 1;
@@ -119,18 +140,466 @@ ct_init
     return ctx;
 }
 
+
+ctContext* 
+ct_initCSR
+(   size_t  numVerts,
+    ctIndex *totalOrder, 
+    size_t  *offsets,
+    ctIndex *adjacency,
+    double  *values
+)
+{
+    ctContext * ctx = ct_init( numVerts, totalOrder, NULL, NULL, NULL );
+    ctx->domain = CT_DOMAIN_CSR;
+    ctx->csrOffsets = offsets;
+    ctx->csrAdjacency = adjacency;
+    ctx->values = values;
+    return ctx;
+}
+
+
+ctContext* 
+ct_initGrid
+(   size_t  dims[3],
+    ctGridConnectivity connectivity,
+    ctIndex *totalOrder, 
+    double  (*value)( ctIndex v, void* ),
+    void*  cbData
+)
+{
+    ctContext * ctx = 
+        ct_init( dims[0]*dims[1]*dims[2], totalOrder, value, NULL, cbData );
+    ctx->domain = CT_DOMAIN_GRID;
+    ctGrid_init( &ctx->grid, dims, connectivity );
+    return ctx;
+}
+
+
+void 
+ct_sortVertices
+(   const void *values,
+    ctValueType type,
+    size_t  numVerts,
+    ctIndex *totalOrder
+)
+{
+    ctSort_vertices( values, type, numVerts, totalOrder, ctThread_numThreads() );
+}
+
+
+void
+ct_numThreads( size_t n )
+{
+    ctThread_setNumThreads( n );
+}
+
+
+ctContext* 
+ct_initFromValues
+(   const void *values,
+    ctValueType type,
+    size_t  numVerts,
+    size_t  (*neighbors)( ctIndex v, ctIndex* nbrs, void* ),
+    void*  cbData
+)
+{
+    ctIndex *order = (ctIndex*) malloc( numVerts * sizeof(ctIndex) );
+    ctContext *ctx = ct_init( numVerts, order, NULL, neighbors, cbData );
+
+    CT_STATS_BEGIN( ctx, CT_PHASE_SORT );
+    ct_sortVertices( values, type, numVerts, order );
+    CT_STATS_END( ctx, CT_PHASE_SORT );
+    ctx->totalOrderOwned = 1;
+    ct_syncMemory( ctx );
+
+    if ( type == CT_VALUE_DOUBLE ) {
+        ctx->values = (double*) values;
+    } else {
+        ctx->typedValues = values;
+        ctx->valueType = type;
+    }
+    return ctx;
+}
+
 void ct_cleanup( ctContext * ctx )
 {
-    if ( ctx->joinComps  ) free( ctx->joinComps );
-    if ( ctx->splitComps ) free( ctx->splitComps );
-    if ( ctx->nextJoin   ) free( ctx->nextJoin );
-    if ( ctx->nextSplit  ) free( ctx->nextSplit );
+    ct_releaseWorking( ctx );
+
+    free( ctx->scratchDir );
+    ctx->scratchDir = 0;
+
+    if ( ctx->totalOrderOwned ) free( ctx->totalOrder );
+    ctx->totalOrder = 0;
+    ctx->totalOrderOwned = 0;
+    ct_syncMemory( ctx );
+}
+
+
+void 
+ct_reset( ctContext * ctx, ctIndex * totalOrder )
+{
+    ct_recycle( ctx, ctx->numVerts );
+    if ( ctx->totalOrderOwned ) free( ctx->totalOrder );
+    ctx->totalOrder = totalOrder;
+    ctx->totalOrderOwned = 0;
+    ct_syncMemory( ctx );
+}
+
+
+void 
+ct_resetValues( ctContext * ctx, const void * values, ctValueType type )
+{
+    ct_recycle( ctx, ctx->numVerts );
+    if ( !ctx->totalOrderOwned ) {
+        ctx->totalOrder = (ctIndex*) malloc( ctx->numVerts * sizeof(ctIndex) );
+        ctx->totalOrderOwned = 1;
+        ct_syncMemory( ctx );
+    }
+    CT_STATS_BEGIN( ctx, CT_PHASE_SORT );
+    ct_sortVertices( values, type, ctx->numVerts, ctx->totalOrder );
+    CT_STATS_END( ctx, CT_PHASE_SORT );
+
+    if ( type == CT_VALUE_DOUBLE ) {
+        ctx->values = (double*) values;
+        ctx->typedValues = 0;
+    } else {
+        ctx->values = 0;
+        ctx->typedValues = values;
+        ctx->valueType = type;
+    }
+}
+
+
+void
+ct_recycle( ctContext * ctx, size_t numVerts )
+{
+    ctx->reuse = 1;
+
+    /* merged, but not decomposed */
+    if ( ctx->tree ) ct_deleteTree( ctx->tree, ctx );
+    ctx->tree = 0;
+
+    /* the per-vertex arrays don't fit another mesh. Everything else does */
+    if ( numVerts != ctx->numVerts ) {
+        ct_freeSweeps( ctx );
+        if ( ctx->spareArcMap ) {
+            ctScratch_free( ctx->spareArcMap, ctx->numVerts * sizeof(ctArc*), 
+                ctx->arcMapMapped );
+            ctMemory_sub( &ctx->mem, CT_MEM_OUTPUT_MAPS, 
+                ctx->numVerts * sizeof(ctArc*) );
+            ctx->spareArcMap = 0;
+        }
+        if ( ctx->arcMapOwned && ctx->arcMap ) ct_freeArcMap( ctx );
+        if ( ctx->branchMapOwned && ctx->branchMap ) {
+            ctScratch_free( ctx->branchMap, ctx->numVerts * sizeof(ctBranch*), 
+                ctx->branchMapMapped );
+            ctMemory_sub( &ctx->mem, CT_MEM_OUTPUT_MAPS, 
+                ctx->numVerts * sizeof(ctBranch*) );
+            ctx->branchMap = 0;
+        }
+        if ( ctx->totalOrderOwned ) free( ctx->totalOrder );
+        ctx->totalOrder = 0;
+        ctx->totalOrderOwned = 0;
+        ctx->numVerts = numVerts;
+        ct_syncMemory( ctx );
+    }
+
+    if ( ctx->arcMapOwned && ctx->arcMap ) {
+        if ( ctx->spareArcMap ) ct_freeArcMap( ctx );
+        else ctx->spareArcMap = ctx->arcMap;
+    }
+    ctx->arcMap = 0;
+    ctx->arcMapOwned = 1;
+    if ( !ctx->branchMapOwned ) ctx->branchMap = 0;
+    ctx->branchMapOwned = 1;
+
+    /* swept, but not merged */
+    ctComponentStore_empty( &ctx->joinStore );
+    ctComponentStore_empty( &ctx->splitStore );
+    ctx->joinRoot = ctx->splitRoot = CT_NIL;
+}
+
+
+/* Everything a run of the algorithm leaves behind, except the maps that
+ * have been taken. */
+static
+void 
+ct_releaseWorking( ctContext * ctx )
+{
+    if ( ctx->spareArcMap ) {
+        ctScratch_free( ctx->spareArcMap, ctx->numVerts * sizeof(ctArc*), 
+            ctx->arcMapMapped );
+        ctMemory_sub( &ctx->mem, CT_MEM_OUTPUT_MAPS, 
+            ctx->numVerts * sizeof(ctArc*) );
+        ctx->spareArcMap = 0;
+    }
+    if ( ctx->leafQ ) ctLeafQ_delete( ctx->leafQ );
+    if ( ctx->priorityQ ) ctPriorityQ_delete( ctx->priorityQ );
+    ctx->leafQ = 0;
+    ctx->priorityQ = 0;
+    ctMemory_set( &ctx->mem, CT_MEM_QUEUES, 0 );
+
+    ct_freeSweeps( ctx );
+    ctComponentStore_clear( &ctx->joinStore );
+    ctComponentStore_clear( &ctx->splitStore );
+    ct_syncMemory( ctx );
     
-    if ( ctx->arcMapOwned && ctx->arcMap != NULL ) free(ctx->arcMap);
-    if ( ctx->branchMapOwned && ctx->branchMap != NULL ) free(ctx->branchMap);
-    if ( ctx->nodeMap != NULL ) ctNodeMap_delete(ctx->nodeMap);
+    if ( ctx->arcMapOwned && ctx->arcMap != NULL ) ct_freeArcMap( ctx );
+    if ( ctx->branchMapOwned && ctx->branchMap != NULL ) {
+        ctScratch_free( ctx->branchMap, ctx->numVerts * sizeof(ctBranch*), 
+            ctx->branchMapMapped );
+        ctMemory_sub( &ctx->mem, CT_MEM_OUTPUT_MAPS, 
+            ctx->numVerts * sizeof(ctBranch*) );
+        ctx->branchMap = 0;
+    }
+    ct_freeNodeMap( ctx );
 
     if (ctx->tree) ct_deleteTree(ctx->tree,ctx); 
+    ctx->tree = 0;
+    if (ctx->treeArena) ct_releaseTreeArena( ctx, ctx->treeArena );
+}
+
+
+void 
+ct_outOfCore( ctContext * ctx, const char * scratchDir )
+{
+    if ( !scratchDir ) scratchDir = ct_defaultScratchDir();
+    free( ctx->scratchDir );
+    ctx->scratchDir = (char*) malloc( strlen(scratchDir) + 1 );
+    strcpy( ctx->scratchDir, scratchDir );
+}
+
+
+void 
+ct_freeMap( ctContext * ctx, void * map )
+{
+    if ( map == NULL ) return;
+    if ( map == (void*)ctx->arcMap ) {
+        ctScratch_free( map, ctx->numVerts * sizeof(ctArc*), ctx->arcMapMapped );
+        if ( ctx->arcMapOwned ) 
+            ctMemory_sub( &ctx->mem, CT_MEM_OUTPUT_MAPS, 
+                ctx->numVerts * sizeof(ctArc*) );
+        ctx->arcMap = 0;
+    } else if ( map == (void*)ctx->branchMap ) {
+        ctScratch_free( map, ctx->numVerts * sizeof(ctBranch*), 
+            ctx->branchMapMapped );
+        if ( ctx->branchMapOwned ) 
+            ctMemory_sub( &ctx->mem, CT_MEM_OUTPUT_MAPS, 
+                ctx->numVerts * sizeof(ctBranch*) );
+        ctx->branchMap = 0;
+    } else {
+        free( map );
+    }
+}
+
+
+static
+const char *
+ct_defaultScratchDir( void )
+{
+    const char * dir = getenv( "TMPDIR" );
+    return dir ? dir : "/tmp";
+}
+
+
+/* Where to put the per-vertex arrays: the out-of-core directory, or NULL
+ * for memory. A memory budget too small for them turns on out-of-core
+ * mode by itself. */
+static
+const char *
+ct_scratchDir( ctContext * ctx )
+{
+    size_t perVertex = 4*sizeof(ctIndex) + sizeof(ctArc*);
+    if ( ctx->scratchDir ) return ctx->scratchDir;
+    if ( ctx->mem.budget && ctx->numVerts * perVertex > ctx->mem.budget ) 
+        return ct_defaultScratchDir();
+    return NULL;
+}
+
+
+/* Sample the memory categories that are not counted as they change, since
+ * the sweeps that grow them may be running on two threads. */
+static
+void
+ct_syncMemory( ctContext * ctx )
+{
+    size_t perVertex = 0;
+    if ( ctx->joinComps  ) perVertex += sizeof(ctComponent);
+    if ( ctx->splitComps ) perVertex += sizeof(ctComponent);
+    if ( ctx->nextJoin   ) perVertex += sizeof(ctIndex);
+    if ( ctx->nextSplit  ) perVertex += sizeof(ctIndex);
+    if ( ctx->totalOrderOwned ) perVertex += sizeof(ctIndex);
+    ctMemory_set( &ctx->mem, CT_MEM_VERTEX_ARRAYS, perVertex * ctx->numVerts );
+    ctMemory_set( &ctx->mem, CT_MEM_COMPONENTS, 
+        ctComponentStore_bytes( &ctx->joinStore ) + 
+        ctComponentStore_bytes( &ctx->splitStore ) );
+}
+
+
+static
+void
+ct_freeArcMap( ctContext * ctx )
+{
+    ctScratch_free( ctx->arcMap, ctx->numVerts * sizeof(ctArc*), 
+        ctx->arcMapMapped );
+    ctx->arcMap = 0;
+    ctMemory_sub( &ctx->mem, CT_MEM_OUTPUT_MAPS, 
+        ctx->numVerts * sizeof(ctArc*) );
+}
+
+
+static
+void
+ct_freeNodeMap( ctContext * ctx )
+{
+    if ( ctx->nodeMap != NULL ) ctNodeMap_delete( ctx->nodeMap );
+    ctx->nodeMap = 0;
+    ctMemory_set( &ctx->mem, CT_MEM_NODE_MAP, 0 );
+}
+
+
+ctTreeArena*
+ct_treeArena( ctContext * ctx )
+{
+    if ( !ctx->treeArena ) 
+        ctx->treeArena = ctTreeArena_new( sizeof(ctArc), sizeof(ctNode) );
+    return ctx->treeArena;
+}
+
+
+ctArena*
+ct_branchArena( ctContext * ctx )
+{
+    if ( !ctx->branchArena ) {
+        ctx->branchArena = (ctArena*) malloc( sizeof(ctArena) );
+        ctArena_init( ctx->branchArena, sizeof(ctBranch), ctx->branchArena );
+    }
+    return ctx->branchArena;
+}
+
+
+/* Free all the arcs and nodes of a tree at once. Only the ones that came
+ * from the arena, that is. */
+static
+void
+ct_releaseTreeArena( ctContext * ctx, ctTreeArena * ta )
+{
+    ctMemory_sub( &ctx->mem, CT_MEM_ARCS, ta->arcs.live * sizeof(ctArc) );
+    ctMemory_sub( &ctx->mem, CT_MEM_NODES, ta->nodes.live * sizeof(ctNode) );
+    if ( ta == ctx->treeArena ) ctx->treeArena = 0;
+    ctTreeArena_delete( ta );
+}
+
+
+/* Like ct_releaseTreeArena, but the slabs stay for the next tree. */
+static
+void
+ct_resetTreeArena( ctContext * ctx )
+{
+    ctTreeArena *ta = ctx->treeArena;
+    ctMemory_sub( &ctx->mem, CT_MEM_ARCS, ta->arcs.live * sizeof(ctArc) );
+    ctMemory_sub( &ctx->mem, CT_MEM_NODES, ta->nodes.live * sizeof(ctNode) );
+    ctTreeArena_reset( ta );
+}
+
+
+/* The queues are made for each run, unless the context is reused, in which
+ * case they are kept in it. */
+static
+ctLeafQ *
+ct_leafQ( ctContext * ctx )
+{
+    if ( ctx->leafQ ) {
+        ctLeafQ_clear( ctx->leafQ );
+        return ctx->leafQ;
+    }
+    if ( ctx->reuse ) return ctx->leafQ = ctLeafQ_new(0);
+    return ctLeafQ_new(0);
+}
+
+static
+ctPriorityQ *
+ct_priorityQ( ctContext * ctx )
+{
+    if ( ctx->priorityQ ) {
+        ctPriorityQ_clear( ctx->priorityQ );
+        return ctx->priorityQ;
+    }
+    if ( ctx->reuse ) return ctx->priorityQ = ctPriorityQ_new();
+    return ctPriorityQ_new();
+}
+
+/* Bytes of queue memory held: the kept queues, or else the one in use. */
+static
+size_t
+ct_queueBytes( ctContext * ctx, size_t inUse )
+{
+    size_t bytes = 0;
+    if ( ctx->leafQ ) bytes += ctx->leafQ->size * sizeof(ctLeafQ_Item);
+    if ( ctx->priorityQ ) 
+        bytes += ctx->priorityQ->storage * sizeof(ctPriorityQ_Item);
+    return bytes ? bytes : inUse;
+}
+
+
+/* Map vertex i to a new node. */
+static
+ctNode *
+ct_newMappedNode( ctContext * ctx, ctIndex i )
+{
+    ctNode * n = ctNode_new( i, ctx );
+    ctNodeMap_insert( ctx->nodeMap, i, n );
+    return n;
+}
+
+
+/* A sweep allocates the per-vertex arrays it writes when it starts, as one
+ * block: comps, then next. Each sweep only touches its own block, so two
+ * can start at once. comps must start out CT_NIL, but the sweep writes
+ * every entry of next. */
+static
+void
+ct_allocSweep( ctContext * ctx, ctComponent ** comps, ctIndex ** next, 
+               int * mapped )
+{
+    size_t bytes = 2 * sizeof(ctIndex) * ctx->numVerts;
+    if ( !*comps ) {
+        *comps = (ctComponent*) 
+            ctScratch_alloc( ct_scratchDir(ctx), bytes, mapped );
+        *next = *comps + ctx->numVerts;
+    }
+    /* the sweeps visit vertices in value order, so readahead is wasted */
+    ctScratch_advise( *comps, bytes, *mapped, CT_SCRATCH_RANDOM );
+    memset( *comps, 0xff, sizeof(ctComponent) * ctx->numVerts );
+}
+
+
+static
+void
+ct_freeSweeps( ctContext * ctx )
+{
+    size_t bytes = 2 * sizeof(ctIndex) * ctx->numVerts;
+    ctScratch_free( ctx->joinComps, bytes, ctx->joinMapped );
+    ctScratch_free( ctx->splitComps, bytes, ctx->splitMapped );
+    ctx->joinComps = ctx->splitComps = 0;
+    ctx->nextJoin = ctx->nextSplit = 0;
+}
+
+
+ctMemoryStats
+ct_memoryStats( ctContext * ctx )
+{
+    ct_syncMemory( ctx );
+    return ctx->mem;
+}
+
+
+void
+ct_memoryBudget( ctContext * ctx, size_t bytes )
+{
+    ctx->mem.budget = bytes;
+    ctx->joinStore.compact = ctx->splitStore.compact = ( bytes != 0 );
 }
 
 
@@ -138,9 +607,10 @@ void ct_joinSweep( ctContext * ctx )
 {
 ct_checkContext(ctx);
 {
+    ct_allocSweep( ctx, &ctx->joinComps, &ctx->nextJoin, &ctx->joinMapped );
     ctx->joinRoot = 
         ct_sweep( 0,ctx->numVerts,+1,
-            CT_JOIN_COMPONENT, ctx->joinComps, ctx->nextJoin, ctx  );
+            &ctx->joinStore, ctx->joinComps, ctx->nextJoin, 0, ctx  );
 }
 }
 
@@ -148,19 +618,20 @@ void ct_splitSweep( ctContext * ctx )
 {
 ct_checkContext(ctx);
 {
+    ct_allocSweep( ctx, &ctx->splitComps, &ctx->nextSplit, &ctx->splitMapped );
     ctx->splitRoot = 
         ct_sweep( ctx->numVerts-1,-1,-1, 
-            CT_SPLIT_COMPONENT, ctx->splitComps, ctx->nextSplit, ctx );
+            &ctx->splitStore, ctx->splitComps, ctx->nextSplit, 1, ctx );
 }
 }
 
 ctArc * ct_mergeTrees( ctContext * ctx )
 {
-    assert(ctx->splitRoot && ctx->joinRoot && 
+    assert(ctx->splitRoot != CT_NIL && ctx->joinRoot != CT_NIL && 
         "Did you call ct_mergeTrees without first calling \
         ct_joinSweep and ct_splitSweep?");
 
-    ct_augment( ctx );
+    ct_augment( ctx, 1 );
     return ctx->tree=ct_merge( ctx );
 }
 
@@ -171,86 +642,168 @@ ct_checkContext(ctx);
 {
     ct_joinSweep(ctx);
     ct_splitSweep(ctx);
-    ct_augment( ctx );
+    ct_augment( ctx, 1 );
     return ctx->tree=ct_merge( ctx );
 }
 }
 
 
+static void ct_joinSweepTask( void * ctx ) { ct_joinSweep( (ctContext*)ctx ); }
+static void ct_splitSweepTask( void * ctx ) { ct_splitSweep( (ctContext*)ctx ); }
+
+ctArc * ct_sweepAndMergeParallel( ctContext * ctx )
+{
+ct_checkContext(ctx);
+{
+    ctThread_func fn[2];
+    void * arg[2];
+
+    fn[0] = ct_joinSweepTask;
+    fn[1] = ct_splitSweepTask;
+    arg[0] = arg[1] = ctx;
+    if ( ctThread_numThreads() > 1 ) {
+        ctThread_runAll( 2, fn, arg );
+    } else {
+        ct_joinSweep( ctx );
+        ct_splitSweep( ctx );
+    }
+
+    ct_augment( ctx, ctThread_numThreads() );
+    return ctx->tree=ct_merge( ctx );
+}
+}
+
+
+
+/* Neighbors of v in a grid domain. Interior vertices just add the stencil
+ * offsets; only vertices on the boundary pay for the bounds checks. */
+static
+size_t
+ct_gridNeighbors( const ctGrid * g, ctIndex v, ctIndex * nbrs )
+{
+    size_t x = v % g->dims[0];
+    size_t y = (v / g->dims[0]) % g->dims[1];
+    size_t z = v / (g->dims[0] * g->dims[1]);
+    size_t k, n = 0;
+
+    if ( x >= g->lo[0] && x < g->hi[0] && 
+         y >= g->lo[1] && y < g->hi[1] && 
+         z >= g->lo[2] && z < g->hi[2] ) 
+    {
+        for ( k = 0; k < g->numOffsets; k++ ) nbrs[k] = v + g->offset[k];
+        return g->numOffsets;
+    }
+
+    for ( k = 0; k < g->numOffsets; k++ ) {
+        /* negative coordinates wrap around to huge ones */
+        if ( x + g->dx[k] >= g->dims[0] ) continue;
+        if ( y + g->dy[k] >= g->dims[1] ) continue;
+        if ( z + g->dz[k] >= g->dims[2] ) continue;
+        nbrs[n++] = v + g->offset[k];
+    }
+    return n;
+}
+
 
 static
-ctComponent* 
+ctComponent 
 ct_sweep
 (   size_t start, 
     size_t end, 
     int inc, 
-    ctComponentType type,
-    ctComponent *comps[],
-    size_t* next, 
-
+    ctComponentStore *cs,
+    ctComponent comps[],
+    ctIndex* next, 
+    size_t worker,
     ctContext* ctx )
 {
 ct_checkContext(ctx);
 {
-    size_t itr = 0, i = 0, n;
-    ctComponent * iComp;
+    size_t itr = 0, n;
+    ctIndex i = 0;
+    ctComponent iComp;
     int numExtrema = 0;
     int numSaddles = 0;
-    size_t * nbrs = calloc ( ctx->maxValence, sizeof(size_t) );
+    ctIndex * nbrBuf = 0;
+
+    CT_STATS_BEGIN( ctx, CT_PHASE_JOIN_SWEEP + worker );
+
+    if ( ctx->domain == CT_DOMAIN_CALLBACK ) 
+        nbrBuf = calloc ( ctx->maxValence, sizeof(ctIndex) );
+    else if ( ctx->domain == CT_DOMAIN_GRID ) 
+        nbrBuf = calloc ( ctx->grid.numOffsets, sizeof(ctIndex) );
 
     for ( itr = start; itr != end; itr += inc ) {
         size_t numNbrs;
+        ctIndex * nbrs;
         int numNbrComps;
         
         i = ctx->totalOrder[itr];
         
-        iComp = NULL;
-        numNbrs = (*(ctx->neighbors))(i,nbrs,ctx->cbData);
+        iComp = CT_NIL;
+        if ( ctx->domain == CT_DOMAIN_CSR ) {
+            /* read the adjacency in place, no callback or copy */
+            nbrs = ctx->csrAdjacency + ctx->csrOffsets[i];
+            numNbrs = ctx->csrOffsets[i+1] - ctx->csrOffsets[i];
+        } else if ( ctx->domain == CT_DOMAIN_GRID ) {
+            nbrs = nbrBuf;
+            numNbrs = ct_gridNeighbors(&ctx->grid,i,nbrs);
+        } else if ( ctx->workerNeighbors ) {
+            nbrs = nbrBuf;
+            CT_STATS_CALL_BEGIN( ctx, worker );
+            numNbrs = (*(ctx->workerNeighbors))(i,nbrs,worker,ctx->cbData);
+            CT_STATS_CALL_END( ctx, worker );
+        } else {
+            nbrs = nbrBuf;
+            CT_STATS_CALL_BEGIN( ctx, worker );
+            numNbrs = (*(ctx->neighbors))(i,nbrs,ctx->cbData);
+            CT_STATS_CALL_END( ctx, worker );
+        }
         numNbrComps = 0;
         for (n = 0; n < numNbrs; n++) {
-            size_t j = nbrs[n];
+            ctIndex j = nbrs[n];
             
-            if ( comps[j] ) {
-                ctComponent * jComp = ctComponent_find( comps[j] );
+            if ( comps[j] != CT_NIL ) {
+                ctComponent jComp = ctComponent_find( cs, comps[j] );
 
                 if (iComp != jComp) {
                     if (numNbrComps == 0) {
                         numNbrComps++;
                         iComp = jComp;
                         comps[i] = iComp;
-                        next[iComp->last] = i;
+                        next[cs->last[iComp]] = i;
                     } else if (numNbrComps == 1) {
                         /* create new component */
-                        ctComponent * newComp = ctComponent_new(type); 
-                        newComp->birth = i;
-                        ctComponent_addPred( newComp, iComp );
-                        ctComponent_addPred( newComp, jComp );
+                        ctComponent newComp = ctComponent_new(cs); 
+                        cs->birth[newComp] = i;
+                        ctComponent_addPred( cs, newComp, iComp );
+                        ctComponent_addPred( cs, newComp, jComp );
 
                         /* finish the two existing components */
-                        iComp->death = i;
-                        iComp->succ = newComp;
-                        ctComponent_union(iComp, newComp);
+                        cs->death[iComp] = i;
+                        cs->succ[iComp] = newComp;
+                        ctComponent_union(cs, iComp, newComp);
 
-                        jComp->death = i;
-                        jComp->succ = newComp;
-                        ctComponent_union(jComp, newComp);
+                        cs->death[jComp] = i;
+                        cs->succ[jComp] = newComp;
+                        ctComponent_union(cs, jComp, newComp);
 
-                        next[ jComp->last ] = i;
+                        next[ cs->last[jComp] ] = i;
 
                         iComp = newComp;
                         comps[i] = newComp;
-                        newComp->last = i;
+                        cs->last[newComp] = i;
 
                         numSaddles++;
                         numNbrComps++;
                         
                     } else {
                         /*finish existing arc */
-                        jComp->death = i;
-                        jComp->succ = iComp;
-                        ctComponent_union(jComp,iComp);
-                        ctComponent_addPred(iComp,jComp);
-                        next[jComp->last] = i;
+                        cs->death[jComp] = i;
+                        cs->succ[jComp] = iComp;
+                        ctComponent_union(cs,jComp,iComp);
+                        ctComponent_addPred(cs,iComp,jComp);
+                        next[cs->last[jComp]] = i;
                     }
                 }
             }
@@ -258,180 +811,557 @@ ct_checkContext(ctx);
 
         if (numNbrComps == 0) {
             /* this was a local maxima. create a new component */
-            iComp = ctComponent_new(type);
-            iComp->birth = i;
+            iComp = ctComponent_new(cs);
+            cs->birth[iComp] = i;
             comps[i] = iComp;
-            iComp->last = i;
+            cs->last[iComp] = i;
             numExtrema++;
         } else if (numNbrComps == 1) {
             /* this was a regular point. set last */
-            iComp->last = i;
+            cs->last[iComp] = i;
         }
 
     } /* for each vertex */
 
     /* tie off end */
-    iComp = ctComponent_find( comps[i] );
-    iComp->death = i;
+    iComp = ctComponent_find( cs, comps[i] );
+    cs->death[iComp] = i;
 
     /* terminate path */
     next[i] = CT_NIL;
 
-    free(nbrs);
+    if ( cs->compact ) ctComponentStore_trim( cs );
+
+    free(nbrBuf);
+
+    CT_STATS_ADD( ctx, sweep[worker].extrema, numExtrema );
+    CT_STATS_ADD( ctx, sweep[worker].saddles, numSaddles );
+    CT_STATS_MOVE( ctx, sweep[worker].finds, cs->finds );
+    CT_STATS_MOVE( ctx, sweep[worker].findSteps, cs->findSteps );
+    CT_STATS_END( ctx, CT_PHASE_JOIN_SWEEP + worker );
     return iComp;
 }
 }
 
 
 
+/* Vertex i is a join birth but not a split birth. Split its split
+ * component there, so that the split tree has a node at i too. */
 static
-void 
-ct_augment( ctContext * ctx )
-{
-ct_checkContext(ctx);
+void
+ct_augmentSplit( ctContext * ctx, ctIndex i )
 {
-    ctComponent **joinComps = ctx->joinComps;
-    ctComponent **splitComps = ctx->splitComps;
-    size_t itr;
+    ctComponentStore *ss = &ctx->splitStore;
+    ctComponent splitComp = ctx->splitComps[i];
+    ctComponent newComp = ctComponent_new(ss);
+
+    CT_STATS_ADD( ctx, sweep[1].augmented, 1 );
+    ss->birth[newComp] = i;
+    ss->death[newComp] = ss->death[splitComp];
+    ss->death[splitComp] = i;
+
+    if (ss->succ[splitComp] != CT_NIL) {
+        ctComponent_removePred( ss, ss->succ[splitComp], splitComp );
+        ctComponent_addPred( ss, ss->succ[splitComp], newComp );
+    }
 
-    int addedToJoin = 0, addedToSplit = 0;
-  
-    for ( itr = 1; itr < ctx->numVerts-1; itr++ ) {
+    ss->succ[newComp] = ss->succ[splitComp];
+    ctComponent_addPred(ss, newComp, splitComp);
+    ss->succ[splitComp] = newComp;
 
-        size_t i = ctx->totalOrder[itr];
-        ctComponent * joinComp = joinComps[i];
-        ctComponent * splitComp = splitComps[i];
+    if (splitComp == ctx->splitRoot) ctx->splitRoot = newComp;
+}
 
-        if (joinComp->birth == i && splitComp->birth != i) {
-            
-            ctComponent * newComp = ctComponent_new(CT_SPLIT_COMPONENT);
-            newComp->birth = i;
-            newComp->death = splitComp->death;
-            splitComp->death = i;
-
-            if (splitComp->succ) {
-                ctComponent_removePred( splitComp->succ, splitComp );
-                ctComponent_addPred( splitComp->succ, newComp );
-            }
 
-            newComp->succ = splitComp->succ;
-            ctComponent_addPred(newComp, splitComp);
-            splitComp->succ = newComp;
+/* Vertex i is a split birth but not a join birth. */
+static
+void
+ct_augmentJoin( ctContext * ctx, ctIndex i )
+{
+    ctComponentStore *js = &ctx->joinStore;
+    ctComponent joinComp = ctx->joinComps[i];
+    ctComponent newComp = ctComponent_new(js);
+
+    CT_STATS_ADD( ctx, sweep[0].augmented, 1 );
+    js->death[newComp] = i;
+    js->birth[newComp] = js->birth[joinComp];
+    js->birth[joinComp] = i;
+
+    while( js->pred[joinComp] != CT_NIL ) {
+        ctComponent p = js->pred[joinComp];
+        ctComponent_removePred(js,joinComp,p);
+        ctComponent_addPred(js,newComp,p);
+        js->succ[p] = newComp;
+    }
 
-            if (splitComp == ctx->splitRoot) ctx->splitRoot = newComp;
+    ctComponent_addPred(js,joinComp,newComp);
+    js->succ[newComp] = joinComp;
+}
 
-            addedToSplit++;
 
-        } else if ( splitComp->birth == i && joinComp->birth != i ) {
+/* 
+ * Whether vertex i is a birth in each tree. Splicing in a component at one
+ * vertex never changes the answer for a later one: it only moves births to
+ * i, and gives deaths to components born before i. So all of these can be
+ * found first, in parallel, and the splices done afterwards.
+ */
+#define CT_JOIN_BIRTH(ctx,i) \
+    ((ctx)->joinStore.birth[(ctx)->joinComps[i]] == (i))
+#define CT_SPLIT_BIRTH(ctx,i) \
+    ((ctx)->splitStore.birth[(ctx)->splitComps[i]] == (i))
 
-            ctComponent * newComp = ctComponent_new(CT_JOIN_COMPONENT);
-            newComp->death = i;
-            newComp->birth = joinComp->birth;
-            joinComp->birth = i;
 
-            while( joinComp->pred ) {
-                ctComponent * p = joinComp->pred;
-                ctComponent_removePred(joinComp,p);
-                ctComponent_addPred(newComp,p);
-                p->succ = newComp;
-            }
+/* One chunk of the augmentation scan. */
+typedef struct ct_AugmentScan
+{
+    ctContext *ctx;
+    size_t start, end;  /* range of totalOrder */
+    ctIndex *points;    /* vertices that need a splice, in order */
+    size_t numPoints, capacity;
+} ct_AugmentScan;
 
-            ctComponent_addPred(joinComp,newComp);
-            newComp->succ = joinComp;
+static 
+void 
+ct_augmentScanTask( void * arg )
+{
+    ct_AugmentScan *scan = (ct_AugmentScan*) arg;
+    ctContext *ctx = scan->ctx;
+    size_t itr;
 
-            addedToJoin++;
+    for ( itr = scan->start; itr < scan->end; itr++ ) {
+        ctIndex i = ctx->totalOrder[itr];
+        if ( CT_JOIN_BIRTH(ctx,i) != CT_SPLIT_BIRTH(ctx,i) ) {
+            if ( scan->numPoints == scan->capacity ) {
+                scan->capacity = scan->capacity ? scan->capacity*2 : 256;
+                scan->points = (ctIndex*) 
+                    realloc( scan->points, scan->capacity * sizeof(ctIndex) );
+            }
+            scan->points[scan->numPoints++] = i;
         }
-
     }
-    free(joinComps);
-    free(splitComps);
-    ctx->joinComps = ctx->splitComps = 0;
-}
 }
 
 
-typedef 
-struct ComponentMap
-{
-    ctComponent **map;
-    size_t size;
-} ComponentMap;
-
+/* chunks smaller than this aren't worth a thread */
+#define CT_AUGMENT_CHUNK ((size_t)1 << 16)
 
-#define CT_COMPONENT_COMPARE1(X,Y) ((X)->birth - Y)
-#define CT_COMPONENT_COMPARE(X,Y) ((X)->birth==(Y)->birth ? 0 : (X)->birth < (Y)->birth ? -1 : 1)
 
 static
-ctComponent*
-ComponentMap_find ( ComponentMap *m, size_t i )
+void 
+ct_augment( ctContext * ctx, size_t numWorkers )
 {
-    int found;
-    size_t ind = 0;
-    
-    SGLIB_ARRAY_BINARY_SEARCH(
-        ctComponent*, m->map, /*what*/
-        0,m->size, /*where*/
-        i, /*who*/
-        CT_COMPONENT_COMPARE1, /*how*/
-        found,ind); /*output*/
-    assert(found);
-    return m->map[ind];
+ct_checkContext(ctx);
+{
+    size_t itr, k;
+
+    CT_STATS_BEGIN( ctx, CT_PHASE_AUGMENT );
+
+    /* both sweeps are done, so everything they built is here */
+    ct_syncMemory( ctx );
+
+    /* tiny meshes go to the serial loop before numVerts-2 can wrap */
+    if ( ctx->numVerts < 2 + 2*CT_AUGMENT_CHUNK ) 
+        numWorkers = 1;
+    else if ( numWorkers > (ctx->numVerts-2) / CT_AUGMENT_CHUNK ) 
+        numWorkers = (ctx->numVerts-2) / CT_AUGMENT_CHUNK;
+
+    if ( numWorkers <= 1 ) {
+        for ( itr = 1; itr + 1 < ctx->numVerts; itr++ ) {
+            ctIndex i = ctx->totalOrder[itr];
+            if ( CT_JOIN_BIRTH(ctx,i) && !CT_SPLIT_BIRTH(ctx,i) ) 
+                ct_augmentSplit( ctx, i );
+            else if ( CT_SPLIT_BIRTH(ctx,i) && !CT_JOIN_BIRTH(ctx,i) ) 
+                ct_augmentJoin( ctx, i );
+        }
+    } else {
+        ct_AugmentScan *scans = 
+            (ct_AugmentScan*) calloc( numWorkers, sizeof(ct_AugmentScan) );
+        ctThread_func *fn = 
+            (ctThread_func*) malloc( numWorkers * sizeof(ctThread_func) );
+        void **arg = (void**) malloc( numWorkers * sizeof(void*) );
+        size_t n = ctx->numVerts-2;
+
+        for ( k = 0; k < numWorkers; k++ ) {
+            scans[k].ctx = ctx;
+            scans[k].start = 1 + n*k/numWorkers;
+            scans[k].end = 1 + n*(k+1)/numWorkers;
+            fn[k] = ct_augmentScanTask;
+            arg[k] = &scans[k];
+        }
+        ctThread_runAll( numWorkers, fn, arg );
+
+        /* splice in order, which makes the trees the same as the serial
+         * loop's */
+        for ( k = 0; k < numWorkers; k++ ) {
+            for ( itr = 0; itr < scans[k].numPoints; itr++ ) {
+                ctIndex i = scans[k].points[itr];
+                if ( CT_JOIN_BIRTH(ctx,i) ) ct_augmentSplit( ctx, i );
+                else ct_augmentJoin( ctx, i );
+            }
+            free( scans[k].points );
+        }
+
+        free( arg );
+        free( fn );
+        free( scans );
+    }
+
+    CT_STATS_END( ctx, CT_PHASE_AUGMENT );
+}
 }
 
 
+/* Queue the leaves of the tree under c_, in depth-first order. */
 static
 void
-ct_queueLeaves( ctLeafQ *lq, ctComponent *c_, ComponentMap *map )
+ct_queueLeaves( ctLeafQ *lq, ctComponentStore *cs, ctComponent c_ )
 {
-    size_t list_mem_size=256, list_size=0;
-    ctComponent**list = malloc(list_mem_size*sizeof(ctComponent*));
-
     size_t stack_mem_size = 1024, stack_size=1;
-    ctComponent **stack = (ctComponent**) malloc( stack_mem_size * sizeof(ctComponent*) );
+    ctComponent *stack = (ctComponent*) malloc( stack_mem_size * sizeof(ctComponent) );
     stack[0] = c_;
      
     while(stack_size) {
-        ctComponent *c = stack[--stack_size];  
-
-        /* add to list */
-        list[list_size++] = c;
-        if (list_size == list_mem_size) {
-            list_mem_size *= 2;
-            list = realloc(list,list_mem_size*sizeof(ctComponent*));
-        }
+        ctComponent c = stack[--stack_size];  
 
-        if (ctComponent_isLeaf(c)) {
-            ctLeafQ_pushBack(lq,c);
+        if (ctComponent_isLeaf(cs,c)) {
+            ctLeafQ_pushBack(lq,c,cs->type);
         } else {
-            ctComponent *pred = c->pred;
-            while (pred->nextPred) pred = pred->nextPred;
-            for (; pred != NULL; pred = pred->prevPred ) {
+            ctComponent pred = cs->pred[c];
+            while (cs->nextPred[pred] != CT_NIL) pred = cs->nextPred[pred];
+            for (; pred != CT_NIL; pred = cs->prevPred[pred] ) {
                 stack[stack_size++] = pred; 
                 if (stack_size == stack_mem_size) {
                     stack_mem_size *= 2;
-                    stack = realloc(stack,stack_mem_size*sizeof(ctComponent*));
+                    stack = realloc(stack,stack_mem_size*sizeof(ctComponent));
                 } 
             }
         }
     }
 
-    SGLIB_ARRAY_SINGLE_QUICK_SORT(ctComponent*,list,list_size,CT_COMPONENT_COMPARE);
-    {   size_t i=0; 
-        for (i=0; i<list_size-1; ++i) assert(list[i]->birth <= list[i+1]->birth);
+    free(stack);
+}
+
+
+/* Make comps map each vertex to the component born there, or CT_NIL. The
+ * births don't change during the merge, so this holds throughout. Two
+ * components share a birth only when the root dies where it was born, at a
+ * saddle that is also the last vertex (a path, for one); the phantom made
+ * after it by ct_merge is the one wanted there, so later ones win. */
+static
+void
+ct_mapBirths( ctComponentStore *cs, ctComponent comps[], size_t numVerts )
+{
+    ctComponent c;
+    memset( comps, 0xff, sizeof(ctComponent) * numVerts );
+    for ( c = 0; c < cs->size; c++ ) comps[cs->birth[c]] = c;
+}
+
+
+
+
+
+
+
+
+
+/* ctArc_find, counted for ct_stats */
+#ifdef CT_STATS
+static
+ctArc *
+ct_findArc( ctContext * ctx, ctArc * a )
+{
+    ctArc *c;
+    ctx->stats.arcFinds++;
+    for ( c = a; c != c->uf; c = c->uf ) ctx->stats.arcFindSteps++;
+    return ctArc_find( a );
+}
+#define CT_FIND_ARC(ctx,a) ct_findArc(ctx,a)
+#else
+#define CT_FIND_ARC(ctx,a) ctArc_find(a)
+#endif
+
+
+/* Is n a leaf of the finished tree, with a as its arc? Nodes get their
+ * arcs up to when the merge takes the component they were born with, which
+ * is also when the merge maps their vertex. Until then a node with one arc
+ * is a death, with more to come. */
+static
+int
+ct_isLeaf( ctContext * ctx, ctNode * n, ctArc * a )
+{
+    return ctx->arcMap[n->i] && 
+        ( ( n->up == a && !a->nextUp && !a->prevUp && !n->down ) ||
+          ( n->down == a && !a->nextDown && !a->prevDown && !n->up ) );
+}
+
+
+/* What the simplifying merge cancels. Each arc keeps its vertices on a
+ * circular list through next, so they can go to the arc it is cancelled
+ * into. The merge may still hold the nodes and arcs cancelled in a step,
+ * so they are freed when the step is over, and their slots go to the arcs
+ * and nodes made after. */
+typedef struct ct_Cancelled {
+    ctIndex *next;
+    ctNode **nodes;
+    ctArc **arcs;
+    size_t numNodes, numArcs, storage;
+} ct_Cancelled;
+
+
+static
+void
+ct_initCancelled( ctContext * ctx, ct_Cancelled * cn )
+{
+    cn->next = (ctIndex*) malloc( ctx->numVerts * sizeof(ctIndex) );
+    if ( !cn->next ) {
+        fprintf( stderr, "ct_merge : out of memory for simplifying\n" );
+        exit(1);
     }
-    
+    ctMemory_add( &ctx->mem, CT_MEM_VERTEX_ARRAYS, ctx->numVerts * sizeof(ctIndex) );
+    cn->storage = 64;
+    cn->nodes = (ctNode**) malloc( cn->storage * sizeof(ctNode*) );
+    cn->arcs = (ctArc**) malloc( cn->storage * sizeof(ctArc*) );
+    cn->numNodes = cn->numArcs = 0;
+}
 
-    free(stack);
-    map->map = list;
-    map->size = list_size;
+
+static
+void
+ct_clearCancelled( ctContext * ctx, ct_Cancelled * cn )
+{
+    ctMemory_sub( &ctx->mem, CT_MEM_VERTEX_ARRAYS, ctx->numVerts * sizeof(ctIndex) );
+    free( cn->next );
+    free( cn->nodes );
+    free( cn->arcs );
+}
+
+
+/* A step cancels at most a few nodes and arcs, but the lists grow if need
+ * be. */
+static
+void
+ct_growCancelled( ct_Cancelled * cn )
+{
+    if ( cn->numNodes < cn->storage && cn->numArcs < cn->storage ) return;
+    cn->storage *= 2;
+    cn->nodes = (ctNode**) realloc( cn->nodes, cn->storage * sizeof(ctNode*) );
+    cn->arcs = (ctArc**) realloc( cn->arcs, cn->storage * sizeof(ctArc*) );
+}
+
+
+/* Map vertex v to arc a. */
+static
+void
+ct_mapVertex( ctContext * ctx, ct_Cancelled * cn, ctIndex v, ctArc * a )
+{
+    ctx->arcMap[v] = a;
+    if ( !ctx->simplify ) return;
+    if ( a->numVertices ) {
+        cn->next[v] = cn->next[a->vertex];
+        cn->next[a->vertex] = v;
+    } else {
+        cn->next[v] = v;
+        a->vertex = v;
+    }
+    a->numVertices++;
+}
+
+
+/* Put arc a, which is out of the tree, in the place of arc old. */
+static
+void
+ct_replaceArc( ctArc * old, ctArc * a )
+{
+    a->hi = old->hi;
+    a->lo = old->lo;
+    a->nextUp = old->nextUp;
+    a->prevUp = old->prevUp;
+    a->nextDown = old->nextDown;
+    a->prevDown = old->prevDown;
+    if ( a->prevUp ) a->prevUp->nextUp = a; else a->lo->up = a;
+    if ( a->nextUp ) a->nextUp->prevUp = a;
+    if ( a->prevDown ) a->prevDown->nextDown = a; else a->hi->down = a;
+    if ( a->nextDown ) a->nextDown->prevDown = a;
+    a->data = old->data;
+    a->children = old->children;
+}
+
+
+/* Arc a, out of the tree now, is cancelled into arc b, which has its data.
+ * The arc with fewer vertices gives them to the other, and takes b's place
+ * in the tree if it is a, so a vertex moves O(log n) times in all. Returns
+ * the arc that stays; the other one is freed at the end of the step. */
+static
+ctArc *
+ct_cancelArc( ctContext * ctx, ct_Cancelled * cn, ctArc * a, ctArc * b )
+{
+    if ( a->numVertices > b->numVertices ) {
+        ctArc *t = a;
+        ct_replaceArc( b, a );
+        a = b;
+        b = t;
+    }
+    if ( a->numVertices ) {
+        ctIndex v = a->vertex;
+        do {
+            ctx->arcMap[v] = b;
+            v = cn->next[v];
+        } while ( v != a->vertex );
+        if ( b->numVertices ) {
+            v = cn->next[a->vertex];
+            cn->next[a->vertex] = cn->next[b->vertex];
+            cn->next[b->vertex] = v;
+        } else {
+            b->vertex = a->vertex;
+        }
+        b->numVertices += a->numVertices;
+    }
+    b->uf = b;
+    ctArc_union( a, b );
+    ct_growCancelled( cn );
+    cn->arcs[cn->numArcs++] = a;
+    return b;
+}
+
+
+/* Node n, out of the tree now, is cancelled. */
+static
+void
+ct_cancelNode( ct_Cancelled * cn, ctNode * n )
+{
+    n->up = n->down = 0;
+    ct_growCancelled( cn );
+    cn->nodes[cn->numNodes++] = n;
+}
+
+
+/* The step is over. Free what it cancelled. */
+static
+void
+ct_freeCancelled( ctContext * ctx, ct_Cancelled * cn )
+{
+    size_t i;
+    for ( i = 0; i < cn->numArcs; i++ ) ctArc_delete( cn->arcs[i], ctx );
+    for ( i = 0; i < cn->numNodes; i++ ) {
+        ctNodeMap_remove( ctx->nodeMap, cn->nodes[i]->i );
+        ctNode_delete( cn->nodes[i], ctx );
+    }
+    cn->numArcs = cn->numNodes = 0;
+}
+
+
+/* Take regular node n out of the tree. Returns the arc it was on. */
+static
+ctArc *
+ct_collapseDead( ctContext * ctx, ct_Cancelled * cn, ctNode * n )
+{
+    ctArc *down = n->down;
+    ctArc *a = ctNode_collapse( n, ctx );
+    ct_cancelNode( cn, n );
+    return ct_cancelArc( ctx, cn, down, a );
 }
 
 
+/* The least priority arc a, seen from its end s, can have when it is
+ * pruned: its leaf's priority if it is a leaf arc. Otherwise, for
+ * persistence, the value difference so far, which only grows as the tree
+ * beyond is pruned. There is no such bound for a priority function, and
+ * -HUGE_VAL keeps the arc from outranking anything. */
+static
+double
+ct_leastPriority( ctContext * ctx, ctNode * s, ctArc * a )
+{
+    ctNode *o = a->hi == s ? a->lo : a->hi;
+    if ( ct_isLeaf(ctx,o,a) ) return ctPriorityQ_priority( o, ctx );
+    if ( ctx->priority ) return -HUGE_VAL;
+    return fabs( s->value - o->value );
+}
 
 
+/* Cancel the leaves below the threshold on one side of node s (its down
+ * arcs if down, else its up arcs). The arc with the greatest priority on
+ * that side stays, so s keeps its place in the tree, and a leaf only goes
+ * if some arc beside it is sure to outlast it, which is the order the
+ * decomposition would prune them in. The leaf's vertices go to that arc.
+ * A node cancelled already has no arcs, and nothing to cancel. */
+static
+void
+ct_cancelLeaves( ctContext * ctx, ctNode * s, int down, ct_Cancelled * cn )
+{
+    ctArc *a, *next, *stay, *top = 0;
+    double first = -HUGE_VAL;
+
+    for ( a = down ? s->down : s->up; a; a = down ? a->nextDown : a->nextUp ) {
+        double p = ct_leastPriority( ctx, s, a );
+        if ( !top || p > first ) {
+            first = p;
+            top = a;
+        }
+    }
 
+    for ( a = down ? s->down : s->up; a; a = next ) {
+        ctNode *o = down ? a->lo : a->hi;
+        double p;
+        /* pruning takes a out of the list */
+        next = down ? a->nextDown : a->nextUp;
+        if ( a == top || !ct_isLeaf(ctx,o,a) ) continue;
+        p = ctPriorityQ_priority( o, ctx );
+        if ( p >= ctx->simplifyThreshold || p > first ) continue;
+
+        ctNode_prune( o );
+        if ( ctx->mergeArcs ) (*(ctx->mergeArcs))( top, a, ctx->cbData );
+        ct_cancelNode( cn, o );
+        /* top may change places with a */
+        stay = ct_cancelArc( ctx, cn, a, top );
+        if ( next == top ) next = stay;
+        top = stay;
+    }
+}
 
 
+/* The merge is over. Leaves it couldn't cancel yet, because the rest of
+ * the tree wasn't there, are pruned by priority as ct_decompose would,
+ * up to the threshold. Returns the arc that a is part of now. */
+static
+ctArc *
+ct_finishSimplify( ctContext * ctx, ct_Cancelled * cn, ctArc * a )
+{
+    ctPriorityQ *pq = ct_priorityQ( ctx );
+
+    ctNodeMap_push_leaves( ctx->nodeMap, pq, ctx );
+
+    while ( !ctPriorityQ_isEmpty(pq) ) {
+        ctNode *n = ctPriorityQ_pop( pq, ctx );
+        ctArc *leafArc = ctNode_leafArc( n ), *into;
+        ctNode *o;
+        int prunedMax = ctNode_isMax( n );
+
+        if ( ctPriorityQ_priority(n,ctx) >= ctx->simplifyThreshold ) break;
+        /* the only arc on its side of the saddle stays */
+        if ( prunedMax ? !leafArc->nextUp && !leafArc->prevUp 
+                       : !leafArc->nextDown && !leafArc->prevDown ) continue;
+
+        o = ctNode_prune( n );
+        into = prunedMax ? o->up : o->down;
+        if ( ctx->mergeArcs ) (*(ctx->mergeArcs))( into, leafArc, ctx->cbData );
+        ct_cancelNode( cn, n );
+        ct_cancelArc( ctx, cn, leafArc, into );
+
+        if ( ctNode_isRegular(o) ) {
+            ctArc *c = ct_collapseDead( ctx, cn, o );
+            if ( ctNode_isMin(c->lo) ) ctPriorityQ_push( pq, c->lo, ctx );
+            if ( ctNode_isMax(c->hi) ) ctPriorityQ_push( pq, c->hi, ctx );
+        }
+        a = CT_FIND_ARC( ctx, a );
+        ct_freeCancelled( ctx, cn );
+    }
+    ctMemory_set( &ctx->mem, CT_MEM_QUEUES, 
+        ct_queueBytes( ctx, pq->storage * sizeof(ctPriorityQ_Item) ) );
+    CT_STATS_MOVE( ctx, priorityUpdates, pq->updates );
+    ctPriorityQ_clear( pq );
+    if ( pq != ctx->priorityQ ) ctPriorityQ_delete( pq );
+    return a;
+}
 
 
 static
@@ -446,78 +1376,124 @@ ct_checkContext(ctx);
     ctArc * arc = NULL;
 
     /* save some keystrokes on ctx-> */
-    ctComponent *joinRoot = ctx->joinRoot;
-    ctComponent *splitRoot = ctx->splitRoot;
-    size_t *nextJoin = ctx->nextJoin;
-    size_t *nextSplit = ctx->nextSplit;
-    ComponentMap joinMap,splitMap;
+    ctComponentStore *js = &ctx->joinStore;
+    ctComponentStore *ss = &ctx->splitStore;
+    ctComponent joinRoot = ctx->joinRoot;
+    ctComponent splitRoot = ctx->splitRoot;
+    ctIndex *nextJoin = ctx->nextJoin;
+    ctIndex *nextSplit = ctx->nextSplit;
+    ctComponent *joinBirths = ctx->joinComps;
+    ctComponent *splitBirths = ctx->splitComps;
     ctArc ** arcMap;
-    ctLeafQ * leafQ = ctLeafQ_new(0);
+    ctLeafQ * leafQ = ct_leafQ( ctx );
+
+    /* what ct_simplifyThreshold takes out of the tree */
+    ct_Cancelled cn;
 
     /* these are set to the above variables, depending of if the leaf is from
      * the join or split tree */
-    ComponentMap  *otherMap;
-    size_t *next; 
+    ctComponentStore *cs, *os;
+    ctComponent *otherBirths;
+    ctIndex *next; 
 
     /* these phantom components take care of some special cases */
-    ctComponent * plusInf = ctComponent_new(CT_JOIN_COMPONENT);
-    ctComponent * minusInf = ctComponent_new(CT_SPLIT_COMPONENT);
-
-    ctComponent_addPred( plusInf, joinRoot );
-    plusInf->birth = joinRoot->death;
-    joinRoot->succ = plusInf;
-
-    ctComponent_addPred( minusInf, splitRoot );
-    minusInf->birth = splitRoot->death;
-    splitRoot->succ = minusInf;
+    ctComponent plusInf = ctComponent_new(js);
+    ctComponent minusInf = ctComponent_new(ss);
+
+    CT_STATS_BEGIN( ctx, CT_PHASE_MERGE );
+
+    ctComponent_addPred( js, plusInf, joinRoot );
+    js->birth[plusInf] = js->death[joinRoot];
+    js->succ[joinRoot] = plusInf;
+
+    ctComponent_addPred( ss, minusInf, splitRoot );
+    ss->birth[minusInf] = ss->death[splitRoot];
+    ss->succ[splitRoot] = minusInf;
+
+    /* the sweeps' vertex-to-component arrays aren't needed any more, so
+     * they become the birth vertex-to-component maps */
+    ct_mapBirths( js, joinBirths, ctx->numVerts );
+    ct_mapBirths( ss, splitBirths, ctx->numVerts );
+
+    ct_syncMemory( ctx );
+
+    /* with a memory budget, a hash of the critical points instead of an
+     * entry for every vertex */
+    if ( ctx->nodeMap && ctx->reuse ) {
+        ctx->nodeMap = 
+            ctNodeMap_reuse( ctx->nodeMap, ctx->numVerts, ctx->mem.budget != 0 );
+    } else {
+        if ( ctx->nodeMap ) ct_freeNodeMap( ctx );
+        ctx->nodeMap = ctNodeMap_new( ctx->numVerts, ctx->mem.budget != 0 );
+    }
 
-    ct_queueLeaves(leafQ, plusInf,  &joinMap);
-    ct_queueLeaves(leafQ, minusInf, &splitMap);
+    ct_queueLeaves(leafQ, js, plusInf);
+    ct_queueLeaves(leafQ, ss, minusInf);
+    ctMemory_set( &ctx->mem, CT_MEM_QUEUES, leafQ->size * sizeof(ctLeafQ_Item) );
+
+    if ( ctx->spareArcMap ) {
+        arcMap = ctx->arcMap = ctx->spareArcMap;
+        ctx->spareArcMap = 0;
+        memset( arcMap, 0, ctx->numVerts * sizeof(ctArc*) );
+    } else {
+        arcMap = ctx->arcMap = (ctArc**) ctScratch_alloc( ct_scratchDir(ctx), 
+            ctx->numVerts * sizeof(ctArc*), &ctx->arcMapMapped );
+        /* a new mapping is already zero */
+        if ( !ctx->arcMapMapped ) 
+            memset( arcMap, 0, ctx->numVerts * sizeof(ctArc*) );
+        ctMemory_add( &ctx->mem, CT_MEM_OUTPUT_MAPS, 
+            ctx->numVerts * sizeof(ctArc*) );
+    }
+    ctScratch_advise( arcMap, ctx->numVerts * sizeof(ctArc*), 
+        ctx->arcMapMapped, CT_SCRATCH_RANDOM );
 
-    arcMap = ctx->arcMap = (ctArc**) calloc( ctx->numVerts, sizeof(ctArc*) );
-    memset( (void*)ctx->arcMap, 0, sizeof(ctArc*)*ctx->numVerts );
+    if ( ctx->simplify ) ct_initCancelled( ctx, &cn );
 
     while(1) {
         assert(! ctLeafQ_isEmpty(leafQ) );
         {
             /* pop leaf from q */
-            ctComponent * leaf = ctLeafQ_popFront(leafQ);
+            ctLeafQ_Item item = ctLeafQ_popFront(leafQ);
+            ctComponent leaf = item.c;
+            ctIndex birth, death;
 
-            if (leaf->death == CT_NIL) { /* all done */
-                arcMap[ leaf->birth ] = arc;
+            /* which tree is this comp from? */
+            if ( item.type == CT_JOIN_COMPONENT ) {
+                cs = js;
+                os = ss;
+                otherBirths = splitBirths;
+                next = nextJoin;
+            } else {
+                cs = ss;
+                os = js;
+                otherBirths = joinBirths;
+                next = nextSplit;
+            }
+            birth = cs->birth[leaf];
+            death = cs->death[leaf];
+
+            if (death == CT_NIL) { /* all done */
+                ct_mapVertex( ctx, &cn, birth, arc );
+                if ( ctx->simplify ) {
+                    ctNode *last = ctNodeMap_find( ctx->nodeMap, birth );
+                    if ( ctNode_isRegular(last) ) 
+                        arc = ct_collapseDead( ctx, &cn, last );
+                    ct_freeCancelled( ctx, &cn );
+                }
                 break;
             }
     
-            /* which tree is this comp from? */
-            if ( leaf->type == CT_JOIN_COMPONENT ) {
+            if ( item.type == CT_JOIN_COMPONENT ) {
                 /* comp is join component */
-                otherMap = &splitMap;
-                
-                next = nextJoin;
-                lo = ctNodeMap_find(ctx->nodeMap,leaf->birth);
-                hi = ctNodeMap_find(ctx->nodeMap,leaf->death);
-                if (!lo) {
-                    lo = ctNode_new(leaf->birth,ctx);
-                    ctNodeMap_insert(&ctx->nodeMap,leaf->birth,lo);
-                }
-                if (!hi) {
-                    hi = ctNode_new(leaf->death,ctx);
-                    ctNodeMap_insert(&ctx->nodeMap,leaf->death,hi);
-                }
+                lo = ctNodeMap_find(ctx->nodeMap,birth);
+                hi = ctNodeMap_find(ctx->nodeMap,death);
+                if (!lo) lo = ct_newMappedNode(ctx,birth);
+                if (!hi) hi = ct_newMappedNode(ctx,death);
             } else { /* split component */
-                otherMap = &joinMap;
-
-                next = nextSplit;
-                hi = ctNodeMap_find(ctx->nodeMap,leaf->birth);
-                lo = ctNodeMap_find(ctx->nodeMap,leaf->death);
-                if (!hi) {
-                    hi = ctNode_new(leaf->birth,ctx);
-                    ctNodeMap_insert(&ctx->nodeMap,leaf->birth,hi);
-                }
-                if (!lo) {
-                    lo = ctNode_new(leaf->death,ctx);
-                    ctNodeMap_insert(&ctx->nodeMap,leaf->death,lo);
-                }
+                hi = ctNodeMap_find(ctx->nodeMap,birth);
+                lo = ctNodeMap_find(ctx->nodeMap,death);
+                if (!hi) hi = ct_newMappedNode(ctx,birth);
+                if (!lo) lo = ct_newMappedNode(ctx,death);
             }
             
             /* create arc */
@@ -526,63 +1502,82 @@ ct_checkContext(ctx);
             ctNode_addUpArc(lo,arc);
             
             { /* gather up points for new arc */
-                size_t c;
-                for( c = leaf->birth; c != leaf->death; c = next[c] ) {
+                ctIndex c;
+                for( c = birth; c != death; c = next[c] ) {
                     if (arcMap[c] == NULL) {
-                        arcMap[c] = arc;
+                        ct_mapVertex( ctx, &cn, c, arc );
                         if (ctx->procVertex) (*(ctx->procVertex))( c, arc, ctx->cbData );
                     }
                 }
             }
+
+            if ( ctx->simplify ) {
+                ctNode *born = item.type == CT_JOIN_COMPONENT ? lo : hi;
+                ctNode *died = item.type == CT_JOIN_COMPONENT ? hi : lo;
+                ct_cancelLeaves( ctx, hi, TRUE, &cn );
+                ct_cancelLeaves( ctx, lo, FALSE, &cn );
+                arc = CT_FIND_ARC( ctx, arc );
+                /* born has all of its arcs now. If it is left regular, it
+                 * goes, and the longer arc may make a leaf to cancel */
+                if ( ctNode_isRegular(born) ) {
+                    arc = ct_collapseDead( ctx, &cn, born );
+                    ct_cancelLeaves( ctx, died, died == arc->hi, &cn );
+                    arc = CT_FIND_ARC( ctx, arc );
+                }
+                ct_freeCancelled( ctx, &cn );
+            }
             
             {    /* remove leaf */
-                ctComponent *succ = leaf->succ;
-                ctComponent *other, *otherSucc, *garbage;
+                ctComponent succ = cs->succ[leaf];
+                ctComponent other, otherSucc;
 
-                ctComponent_prune( leaf );
+                ctComponent_prune( cs, leaf );
         
                 /* remove leaf's counterpart in other tree */
-                other = ComponentMap_find( otherMap, leaf->birth );
-                otherSucc = ComponentMap_find(otherMap,succ->birth);
+                other = otherBirths[birth];
+                otherSucc = otherBirths[cs->birth[succ]];
 
-                assert(other);
-                assert(ctComponent_isRegular(other)) ;
+                assert(ctComponent_isRegular(os,other)) ;
         
-                garbage = ctComponent_eatSuccessor(other->pred);
-
-                /*
-                if (garbage != plusInf && garbage != minusInf) 
-                    ctComponent_delete( garbage );
-                */
+                ctComponent_eatSuccessor(os,os->pred[other]);
 
-                if ( ctComponent_isLeaf(succ) && ctComponent_isRegular(otherSucc) )  {
-                    ctLeafQ_pushBack(leafQ, succ);
-                } else if (ctComponent_isRegular(succ) && ctComponent_isLeaf(otherSucc)) {
-                    ctLeafQ_pushBack(leafQ, otherSucc);
+                if ( ctComponent_isLeaf(cs,succ) && ctComponent_isRegular(os,otherSucc) )  {
+                    ctLeafQ_pushBack(leafQ, succ, cs->type);
+                } else if (ctComponent_isRegular(cs,succ) && ctComponent_isLeaf(os,otherSucc)) {
+                    ctLeafQ_pushBack(leafQ, otherSucc, os->type);
                 }
-        
-                /*ctComponent_delete(leaf);*/
             }
         }
     }
 
-    ctx->joinRoot = 0;
-    ctx->splitRoot = 0;
-  
-    {   size_t i;
-        for (i=0; i<joinMap.size; ++i) free(joinMap.map[i]);
-        for (i=0; i<splitMap.size; ++i) free(splitMap.map[i]);
+    if ( ctx->simplify ) {
+        arc = ct_finishSimplify( ctx, &cn, arc );
+        ct_clearCancelled( ctx, &cn );
     }
-        
-    /* 
-    ctComponent_delete( plusInf );
-    ctComponent_delete( minusInf );
-    */
-    ctLeafQ_delete( leafQ );
 
-    free( joinMap.map );
-    free( splitMap.map );
+    ctx->joinRoot = CT_NIL;
+    ctx->splitRoot = CT_NIL;
+  
+    ctMemory_set( &ctx->mem, CT_MEM_QUEUES, 
+        ct_queueBytes( ctx, leafQ->size * sizeof(ctLeafQ_Item) ) );
+    ctMemory_set( &ctx->mem, CT_MEM_NODE_MAP, ctNodeMap_bytes(ctx->nodeMap) );
+    CT_STATS_MOVE( ctx, leafQueueGrowths, leafQ->grown );
+    if ( leafQ != ctx->leafQ ) ctLeafQ_delete( leafQ );
+    ctMemory_set( &ctx->mem, CT_MEM_QUEUES, ct_queueBytes( ctx, 0 ) );
+
+    /* the merge was the last reader of the components and the paths. A
+     * reused context keeps them for the next run */
+    if ( ctx->reuse ) {
+        ctComponentStore_empty( js );
+        ctComponentStore_empty( ss );
+    } else {
+        ctComponentStore_clear( js );
+        ctComponentStore_clear( ss );
+        ct_freeSweeps( ctx );
+    }
+    ct_syncMemory( ctx );
 
+    CT_STATS_END( ctx, CT_PHASE_MERGE );
     return arc;
 }
 }
@@ -600,8 +1595,15 @@ if ( ctx->arcMap == 0 ) {
 
 {
     ctBranch * root = 0;
-    ctPriorityQ * pq = ctPriorityQ_new();
+    ctPriorityQ * pq;
+
+    CT_STATS_BEGIN( ctx, CT_PHASE_DECOMPOSE );
+    pq = ct_priorityQ( ctx );
+
+    /* the decomposition gets a fresh branch arena, which goes with it */
+    ctx->branchArena = 0;
     ctNodeMap_push_leaves(ctx->nodeMap,pq,ctx);
+    ctMemory_set( &ctx->mem, CT_MEM_QUEUES, pq->storage * sizeof(ctPriorityQ_Item) );
 
     for(;;) {
         ctNode * n = ctPriorityQ_pop(pq,ctx);
@@ -620,7 +1622,6 @@ if ( ctx->arcMap == 0 ) {
         }
         {   ctBranch * b = 0;
             ctNode * o = 0;
-            int prunedMax = 0;
     
             if (ctNode_isMax(n)) {
                 if ( ctNode_leafArc(n)->nextUp == NULL && 
@@ -629,7 +1630,6 @@ if ( ctx->arcMap == 0 ) {
                     continue;
                 }
                 b = ctBranch_new( n->i, ctNode_otherNode(n)->i, ctx );
-                prunedMax = TRUE;
             } else if (ctNode_isMin(n)) {
                 if ( ctNode_leafArc(n)->nextDown == NULL && 
                      ctNode_leafArc(n)->prevDown == NULL ) 
@@ -637,7 +1637,6 @@ if ( ctx->arcMap == 0 ) {
                     continue;
                 }
                 b = ctBranch_new(n->i,ctNode_otherNode(n)->i, ctx);
-                prunedMax = FALSE;
             } else {
                 fprintf(stderr,"decompose() : arc was neither max nor min\n");
             }
@@ -654,31 +1653,68 @@ if ( ctx->arcMap == 0 ) {
             }
     
             o = ctNode_prune(n);
-            ctBranchList_add(&(o->children),b, ctx);
+            ctBranchList_push(&(o->children),b);
     
             if (ctNode_isRegular(o)) {
                 ctArc * a = ctNode_collapse(o, ctx); /*lists get merged here*/
-                if (prunedMax) {
-                    if (ctNode_isMin(a->lo)) ctPriorityQ_push(pq,a->lo,ctx);
-                } else {
-                    if (ctNode_isMax(a->hi)) ctPriorityQ_push(pq,a->hi,ctx);
-                }
+                /* a is longer now, so its leaves' priorities change */
+                if (ctNode_isMin(a->lo)) ctPriorityQ_push(pq,a->lo,ctx);
+                if (ctNode_isMax(a->hi)) ctPriorityQ_push(pq,a->hi,ctx);
             }
         }
     }
 
+    /* the child lists were built in no order, which saves a walk along
+     * the list for every child; put them in saddle order once, here */
+    ctBranch_sortChildren( root, ctx );
+    CT_STATS_END( ctx, CT_PHASE_DECOMPOSE );
+
     {   /* create branch map */
         size_t i;
-        ctx->branchMap = (ctBranch**)calloc(ctx->numVerts,sizeof(ctBranch*));
-        memset( (void*)ctx->branchMap, 0, sizeof(ctBranch*)*ctx->numVerts );
+        CT_STATS_BEGIN( ctx, CT_PHASE_BRANCH_MAP );
+        /* a reused context's map from the last run, if it wasn't taken */
+        if ( !(ctx->reuse && ctx->branchMap) ) {
+            ctx->branchMap = (ctBranch**) ctScratch_alloc( ct_scratchDir(ctx), 
+                ctx->numVerts*sizeof(ctBranch*), &ctx->branchMapMapped );
+            ctMemory_add( &ctx->mem, CT_MEM_OUTPUT_MAPS, 
+                ctx->numVerts * sizeof(ctBranch*) );
+        }
+        /* this one pass is in vertex order */
+        ctScratch_advise( ctx->arcMap, ctx->numVerts * sizeof(ctArc*), 
+            ctx->arcMapMapped, CT_SCRATCH_SEQUENTIAL );
+        ctScratch_advise( ctx->branchMap, ctx->numVerts * sizeof(ctBranch*), 
+            ctx->branchMapMapped, CT_SCRATCH_SEQUENTIAL );
         for ( i = 0; i < ctx->numVerts; i++) {
             ctArc * a = ctx->arcMap[i];
             assert(a);
-            ctx->branchMap[i] = ctArc_find(a)->branch;
+            ctx->branchMap[i] = CT_FIND_ARC(ctx,a)->branch;
         }
+        CT_STATS_END( ctx, CT_PHASE_BRANCH_MAP );
     }
     
-    ctPriorityQ_delete(pq);
+    ctMemory_set( &ctx->mem, CT_MEM_QUEUES, 
+        ct_queueBytes( ctx, pq->storage * sizeof(ctPriorityQ_Item) ) );
+    CT_STATS_MOVE( ctx, priorityUpdates, pq->updates );
+    /* the leaves left in it are about to go with the tree */
+    ctPriorityQ_clear(pq);
+    if ( pq != ctx->priorityQ ) ctPriorityQ_delete(pq);
+    ctMemory_set( &ctx->mem, CT_MEM_QUEUES, ct_queueBytes( ctx, 0 ) );
+
+    /* the tree is consumed, so it and the maps into it are done with. A
+     * reused context keeps their memory for the next run */
+    if ( ctx->reuse ) {
+        if ( ctx->arcMapOwned ) {
+            ctx->spareArcMap = ctx->arcMap;
+            ctx->arcMap = 0;
+        }
+        if ( ctx->treeArena ) ct_resetTreeArena( ctx );
+    } else {
+        ct_freeNodeMap( ctx );
+        if ( ctx->arcMapOwned ) ct_freeArcMap( ctx );
+        if ( ctx->treeArena ) ct_releaseTreeArena( ctx, ctx->treeArena );
+    }
+    ctx->branchArena = 0;
+
     ctx->tree = 0;
     return root;
 }
@@ -691,15 +1727,22 @@ void
 ct_checkContext ( ctContext * ctx ) 
 {
     assert( ctx->numVerts > 0 );
+    assert( ctx->numVerts < CT_NIL && "too many vertices for ctIndex" );
     assert( ctx->totalOrder );
-    assert( ctx->value );
-    assert( ctx->neighbors );
+    assert( ctx->value || ctx->values || ctx->typedValues );
+    assert( ctx->domain != CT_DOMAIN_CALLBACK || 
+            ctx->neighbors || ctx->workerNeighbors );
+    assert( ctx->domain != CT_DOMAIN_CSR || 
+            (ctx->csrOffsets && ctx->csrAdjacency) );
 }
 
 
 ctArc ** 
 ct_arcMap(ctContext * ctx)
 {
+    if ( ctx->arcMapOwned && ctx->arcMap ) 
+        ctMemory_sub( &ctx->mem, CT_MEM_OUTPUT_MAPS, 
+            ctx->numVerts * sizeof(ctArc*) );
     ctx->arcMapOwned = 0;
     return ctx->arcMap;
 }
@@ -707,23 +1750,14 @@ ct_arcMap(ctContext * ctx)
 ctBranch ** 
 ct_branchMap( ctContext * ctx )
 {
+    if ( ctx->branchMapOwned && ctx->branchMap ) 
+        ctMemory_sub( &ctx->mem, CT_MEM_OUTPUT_MAPS, 
+            ctx->numVerts * sizeof(ctBranch*) );
     ctx->branchMapOwned = 0;
     return ctx->branchMap;
 }
 
 
-ctArc* ct_arcMalloc( void* cbData ) { return (ctArc*)malloc(sizeof(ctArc)); }
-void ct_arcFree( ctArc* arc, void* cbData ) { free(arc); }
-
-ctNode* ct_nodeMalloc( void* cbData ) { return (ctNode*)malloc(sizeof(ctNode)); }
-void ct_nodeFree( ctNode* node, void* cbData ) { free(node); }
-
-ctBranch* ct_branchMalloc( void* cbData ) { return (ctBranch*)malloc(sizeof(ctBranch)); }
-void ct_branchFree( ctBranch* branch, void* cbData ) { free(branch); }
-
-
-    
-
 void 
 ct_arcAllocator
 (   ctContext * ctx, 
@@ -784,13 +1818,17 @@ ctArc*
 ct_copyTree( ctArc *src, int moveData, ctContext *ctx )
 {
     ctNode *start = src->lo;
-    ctNodeMap *nodeMap=0;
+    ctNodeMap *nodeMap=ctNodeMap_new(ctx->numVerts,TRUE);
     ctArc *a=0; /* arc iterator in for loops */
     ctArc *anArc=0; /* will return an arc of the new tree */
+    ctTreeArena *srcArena = ctx->treeArena;
 
     size_t stack_cap = 256, stack_size;
     NodePair *stack = (NodePair*)malloc(sizeof(NodePair)*stack_cap);
 
+    /* the copy is built in an arena of its own */
+    ctx->treeArena = 0;
+
     stack_size=1; 
     stack[0].node = start;
     stack[0].prev = 0;
@@ -803,7 +1841,7 @@ ct_copyTree( ctArc *src, int moveData, ctContext *ctx )
 
         assert(!n->up   || n->up->lo == n); 
         assert(!n->down || n->down->hi == n);
-        ctNodeMap_insert(&nodeMap,n->i,newNode); 
+        ctNodeMap_insert(nodeMap,n->i,newNode); 
         if (moveData) {
             newNode->data=n->data; 
             n->data=newNode;
@@ -875,6 +1913,8 @@ ct_copyTree( ctArc *src, int moveData, ctContext *ctx )
     }
    
     ctNodeMap_delete(nodeMap);
+    free(stack);
+    ctx->treeArena = srcArena;
     return anArc;
 }
 
@@ -936,6 +1976,7 @@ ct_arcsAndNodes
     *numArcsOut = arcs_size;
     *nodesOut = (ctNode**)realloc(nodes,sizeof(ctNode*)*nodes_size);
     *numNodesOut = nodes_size;
+    free(stack);
 }
 
 void
@@ -944,6 +1985,13 @@ ct_deleteTree( ctArc *a, ctContext *ctx )
     size_t narcs,nnodes,i;
     ctArc **arcs;
     ctNode **nodes;
+
+    if ( !ctx->arcFree && !ctx->nodeFree ) {
+        /* the whole tree is in one arena */
+        ct_releaseTreeArena( ctx, (ctTreeArena*) ctArena_of(a)->owner );
+        return;
+    }
+
     ct_arcsAndNodes(a,&arcs,&narcs,&nodes,&nnodes);
     for (i=0; i<narcs; ++i) ctArc_delete(arcs[i],ctx);
     for (i=0; i<nnodes; ++i) ctNode_delete(nodes[i],ctx);
@@ -952,10 +2000,48 @@ ct_deleteTree( ctArc *a, ctContext *ctx )
 }
 
 
+void
+ct_deleteBranchTree( ctBranch *root, ctContext *ctx )
+{
+    if ( !ctx ) {
+        /* from ct_batch, whose contexts are gone. The tree has its own arena */
+        ctArena *arena = ctArena_of( root );
+        assert( root->parent == NULL );
+        ctArena_clear( arena );
+        free( arena );
+    } else if ( !ctx->branchFree && root->parent == NULL ) {
+        ctArena *arena = ctArena_of( root );
+        ctMemory_sub( &ctx->mem, CT_MEM_BRANCHES, arena->live * sizeof(ctBranch) );
+        if ( arena == ctx->branchArena ) ctx->branchArena = 0;
+        ctArena_clear( arena );
+        free( arena );
+    } else {
+        ctBranch_delete( root, ctx );
+    }
+}
+
+
+void 
+ct_workerNeighborsFunc
+(   ctContext *ctx, 
+    size_t (*neighbors)( ctIndex v, ctIndex* nbrs, size_t worker, void* ) )
+{
+    ctx->workerNeighbors = neighbors;
+}
+
+
 void 
 ct_priorityFunc( ctContext *ctx, double (*priorityFunc)(ctNode*,void*) )
 {
     ctx->priority = priorityFunc;
 }
 
+
+void 
+ct_simplifyThreshold( ctContext *ctx, double threshold )
+{
+    ctx->simplify = TRUE;
+    ctx->simplifyThreshold = threshold;
+}
+
 /**/